@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "AntColony.h"
+#include "Instance.h"
+#include "LocalSearch.h"
+#include "Logger.h"
+#include "Random.h"
+
+// Micro-benchmarks of the solver hot paths on generated spectra of growing size.
+// Every benchmark repeats its operation until it ran for at least --min-time and
+// reports the time and heap allocations per operation.
+
+namespace
+{
+    std::atomic<size_t> allocations{ 0 };
+
+    void* allocate(size_t size)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        if (void* pointer = std::malloc(size ? size : 1))
+            return pointer;
+        throw std::bad_alloc{};
+    }
+
+    void* allocateAligned(size_t size, std::align_val_t alignment)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        const size_t align = static_cast<size_t>(alignment);
+#ifdef _WIN32
+        void* pointer = _aligned_malloc(size ? size : 1, align);
+#else
+        void* pointer = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+#endif
+        if (!pointer)
+            throw std::bad_alloc{};
+        return pointer;
+    }
+
+    void freeAligned(void* pointer)
+    {
+#ifdef _WIN32
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void operator delete(void* pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { freeAligned(pointer); }
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        // the dense matrix and the colony fit the memory limit up to 10000, PREFIX_INDEX
+        // runs at every size
+        std::vector<size_t> sizes{ 200, 1000, 5000, 10000, 100000 };
+        std::chrono::milliseconds minTime{ 200 };
+        size_t memoryLimit = size_t{ 2048 } << 20; // bytes
+        std::string filter;
+    };
+
+    Options options;
+    bool failed = false; // a check did not hold
+
+    // keeps the optimiser from dropping a result
+    volatile size_t sink = 0;
+
+    // Runs `operation` in batches that double until one batch takes minTime, and prints
+    // the figures of the last batch. `items` is the work of one operation, e.g. the
+    // pairs compared, for the throughput column.
+    void measure(const std::string& name, size_t size, double items, const char* unit,
+        const std::function<void()>& operation)
+    {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+            return;
+
+        operation(); // warm-up
+
+        size_t batch = 1;
+        while (true)
+        {
+            const size_t allocationsBefore = allocations.load();
+            const auto start = Clock::now();
+            for (size_t i = 0; i < batch; ++i)
+                operation();
+            const auto elapsed = Clock::now() - start;
+            const size_t allocated = allocations.load() - allocationsBefore;
+
+            if (elapsed < options.minTime && batch < (size_t{ 1 } << 30))
+            {
+                batch *= 2;
+                continue;
+            }
+
+            const double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count() / batch;
+            std::cout << std::left << std::setw(32) << name << std::right << std::setw(8) << size
+                      << std::setw(16) << std::fixed << std::setprecision(1) << nanoseconds
+                      << std::setw(16) << std::setprecision(3) << items / nanoseconds * 1e3 << ' ' << std::left
+                      << std::setw(14) << (std::string{ "M" } + unit + "/s") << std::right
+                      << std::setw(12) << std::setprecision(2) << (double)allocated / batch << '\n';
+            return;
+        }
+    }
+
+    void skipped(const std::string& name, size_t size, size_t bytes)
+    {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+            return;
+
+        std::cout << std::left << std::setw(32) << name << std::right << std::setw(8) << size
+                  << "  skipped, needs " << (bytes >> 20) << " MB\n";
+    }
+
+    // every l-mer of a random sequence, shuffled, named like a test file without errors
+    std::string makeSpectrum(size_t s, size_t l, uint64_t seed)
+    {
+        CounterRng random{ seed };
+        std::string sequence(s + l - 1, 'A');
+        for (char& base : sequence)
+            base = "ACGT"[random.nextBelow(4)];
+
+        std::vector<size_t> order(s);
+        for (size_t i = 0; i < s; ++i)
+            order[i] = i;
+        for (size_t i = s; i > 1; --i)
+            std::swap(order[i - 1], order[random.nextBelow(i)]);
+
+        std::string spectrum;
+        spectrum.reserve(s * (l + 1));
+        for (size_t i : order)
+        {
+            spectrum.append(sequence, i, l);
+            spectrum += '\n';
+        }
+        return spectrum;
+    }
+
+    std::unique_ptr<Instance> makeInstance(size_t s, size_t l = 10, const InstanceOptions& instanceOptions = {})
+    {
+        return std::make_unique<Instance>("1." + std::to_string(s) + "-0", makeSpectrum(s, l, s), instanceOptions);
+    }
+
+    // probes too long to pack are compared as strings
+    void benchmarkStrings()
+    {
+        const std::unique_ptr<Instance> instance = makeInstance(1000, MAX_PACKED_LENGTH + 8);
+        const size_t s = instance->oligonucleotides.size();
+        measure("Instance::buildAdjMatrix strings", s, (double)s * s, "pairs", [&] { instance->buildAdjMatrix(); });
+    }
+
+    // O(s * l) memory, so never skipped
+    void benchmarkIndexed(size_t s)
+    {
+        InstanceOptions instanceOptions;
+        instanceOptions.buildMode = InstanceOptions::PREFIX_INDEX;
+        instanceOptions.denseMatrix = false;
+        std::unique_ptr<Instance> instance = makeInstance(s, 10, instanceOptions);
+        measure("Instance::buildOverlapsIndexed", s, (double)s, "oligos", [&] { instance->buildOverlapsIndexed(); });
+    }
+
+    // whether `edited` has the adjMatrix, candidate lists and counts of an instance
+    // built from its spectrum as it is now
+    bool matchesFreshBuild(const Instance& edited)
+    {
+        std::string spectrum;
+        for (std::string_view oligonucleotide : edited.oligonucleotides)
+        {
+            spectrum.append(oligonucleotide);
+            spectrum += '\n';
+        }
+        Instance fresh{ edited.name, spectrum };
+        fresh.buildCandidateLists(edited.candidates.maxCandidates());
+
+        const size_t size = fresh.oligonucleotides.size();
+        if (edited.oligonucleotides.size() != size || edited.numErrors != fresh.numErrors
+            || edited.bestSolutionSize != fresh.bestSolutionSize)
+            return false;
+        for (size_t i = 0; i < size; ++i)
+        {
+            if (!std::equal(fresh.adjMatrix.row(i), fresh.adjMatrix.row(i) + size, edited.adjMatrix.row(i)))
+                return false;
+            if (edited.candidates.count(i) != fresh.candidates.count(i))
+                return false;
+            for (size_t c = 0; c < fresh.candidates.count(i); ++c)
+            {
+                if (!edited.candidates.contains(i, fresh.candidates.vertices(i)[c]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // removes a random oligonucleotide and adds it back, which keeps the size
+    void benchmarkEdits(Instance& instance)
+    {
+        const std::string name = "Instance::edit";
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+            return;
+
+        const size_t s = instance.oligonucleotides.size();
+        instance.buildCandidateLists(8);
+        CounterRng random{ s };
+        measure(name, s, 2.0, "edits", [&] {
+            const size_t v = random.nextBelow(s);
+            const std::string oligonucleotide{ instance.oligonucleotides[v] };
+            instance.removeOligonucleotide(v);
+            instance.addOligonucleotide(oligonucleotide);
+        });
+
+        // a fresh build next to the edited one
+        if (2 * s * s > options.memoryLimit)
+        {
+            skipped(name + " check", s, 2 * s * s);
+            return;
+        }
+        const bool matches = matchesFreshBuild(instance);
+        std::cout << std::left << std::setw(32) << name + " check" << std::right << std::setw(8) << s
+                  << (matches ? "  matches a fresh build\n" : "  does not match a fresh build\n");
+        failed = failed || !matches;
+    }
+
+    void benchmarkSize(size_t s)
+    {
+        const size_t matrixBytes = s * s;
+        // matrix, pheromone, choice info and tree, and a bit per entry for deposits
+        const size_t colonyBytes = 13 * s * s + s * s / 8;
+        if (matrixBytes > options.memoryLimit)
+        {
+            for (const char* name : { "Instance::buildAdjMatrix", "AntColony::Step 1 ant", "AntColony::Step",
+                "LocalSearch::run 1 step", "cost", "Instance::edit" })
+                skipped(name, s, name[0] == 'A' ? colonyBytes : matrixBytes);
+            return;
+        }
+
+        std::unique_ptr<Instance> instance = makeInstance(s);
+        measure("Instance::buildAdjMatrix", s, (double)s * s, "pairs", [&] { instance->buildAdjMatrix(); });
+
+        Solution solution;
+        if (colonyBytes > options.memoryLimit)
+        {
+            skipped("AntColony::Step 1 ant", s, colonyBytes);
+            skipped("AntColony::Step", s, colonyBytes);
+
+            // a prefix of the spectrum order stands in for an ant path
+            for (size_t i = 0, length = instance->l; i < s && length <= instance->n / 2; ++i)
+            {
+                if (i > 0)
+                    length += instance->adjMatrix(solution.back(), i);
+                solution.push_back(i);
+            }
+        }
+        else
+        {
+            // Step runs an iteration as long as no ant reaches the target, so the target
+            // is out of reach while the colonies are timed
+            const size_t target = instance->bestSolutionSize;
+            instance->bestSolutionSize = s + 1;
+            AntColony::Buffers buffers;
+
+            AntColony::Parameters single(std::numeric_limits<int>::max(), 1, 1.0f, 1.0f, 0.7f);
+            single.Seed = 1;
+            {
+                AntColony colony(*instance, single, nullptr, &buffers);
+                measure("AntColony::Step 1 ant", s, 1.0, "paths", [&] { sink += colony.Step(); });
+            }
+
+            AntColony::Parameters parameters(std::numeric_limits<int>::max(), 10, 1.0f, 1.0f, 0.7f);
+            parameters.Seed = 1;
+            AntColony colony(*instance, parameters, nullptr, &buffers);
+            measure("AntColony::Step", s, parameters.Ants, "ants", [&] { sink += colony.Step(); });
+            instance->bestSolutionSize = target;
+
+            // half an ant path leaves insertions for the local search to rank
+            std::vector<int> path = colony.Best();
+            solution.assign(path.begin(), path.begin() + path.size() / 2);
+        }
+
+        // one step from the same solution every time, a search scans its neighbourhood
+        // and applies the best move
+        LocalSearch::Scratch scratch;
+        const size_t n = solution.size();
+        measure("LocalSearch::run 1 step", s, (double)(s - n) * (n + 1), "moves", [&] {
+            LocalSearch localSearch(*instance, solution, false, LocalSearch::TabuMode::SOLUTIONS, nullptr, &scratch);
+            sink += localSearch.run(30, 1).size();
+        });
+        measure("cost", s, (double)n, "edges", [&] { sink += cost(solution, instance.get()); });
+
+        benchmarkEdits(*instance);
+    }
+
+    std::vector<size_t> parseSizes(const std::string& list)
+    {
+        std::vector<size_t> sizes;
+        std::stringstream stream{ list };
+        std::string size;
+        while (std::getline(stream, size, ','))
+            sizes.push_back(std::stoul(size));
+        return sizes;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Logger::Init();
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+                options.sizes = parseSizes(argv[++i]);
+            else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+                options.minTime = std::chrono::milliseconds{ std::stol(argv[++i]) };
+            else if (std::strcmp(argv[i], "--memory-limit") == 0 && i + 1 < argc)
+                options.memoryLimit = std::stoull(argv[++i]) << 20;
+            else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+                options.filter = argv[++i];
+            else
+                throw std::invalid_argument{ argv[i] };
+        }
+    }
+    catch (const std::exception&)
+    {
+        std::cout << "usage: Benchmark [--sizes 200,1000,...] [--min-time MS] [--memory-limit MB] [--filter NAME]\n";
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(32) << "benchmark" << std::right << std::setw(8) << "s"
+              << std::setw(16) << "ns/op" << std::setw(16) << "throughput" << std::setw(15) << ""
+              << std::setw(12) << "allocs/op" << '\n';
+
+    benchmarkStrings();
+    for (size_t s : options.sizes)
+    {
+        benchmarkIndexed(s);
+        benchmarkSize(s);
+    }
+
+    return failed ? 1 : 0;
+}
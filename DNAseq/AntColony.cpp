@@ -2,142 +2,751 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <map>
-#include <set>
+#include <numeric>
 
 #include "Logger.h"
 
-AntColony::AntColony(const Instance& instance, const Parameters& parameters)
-	: m_Instance(instance), m_Parameters(parameters) {
-	int size = m_Instance.oligonucleotides.size();
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ANT_COLONY_SSE2
+#endif
+
+namespace {
+
+	// Marks every vertex that is still available and fits into the remaining length,
+	// stores its choice weight as the weight and -1 for every other vertex, and returns
+	// the sum of the weights. Vertices once marked -1 stay unavailable. Choice info
+	// below zero is a trail at the MAX-MIN floor, minus its heuristic, which weighs
+	// floorWeight times that.
+	float AccumulateWeights(const float* choiceInfo, float floorWeight, const OverlapMatrix::Weight* distances,
+		int remainingLength, float* weights, int size, int& availableVertices) {
+		float weightsSum = 0.f;
+		int available = 0;
+		int i = 0;
+
+#ifdef ANT_COLONY_SSE2
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 unavailable = _mm_set1_ps(-1.f);
+		const __m128i limit = _mm_set1_epi32(remainingLength);
+		const __m128i zeroBytes = _mm_setzero_si128();
+		const __m128 floorScale = _mm_set1_ps(-floorWeight);
+		__m128 sums = _mm_setzero_ps();
+		__m128i counts = _mm_setzero_si128();
+		for (; i + 4 <= size; i += 4) {
+			int packedDistances;
+			std::memcpy(&packedDistances, distances + i, sizeof(packedDistances));
+			__m128i distance = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packedDistances), zeroBytes), zeroBytes);
+
+			__m128 fits = _mm_castsi128_ps(_mm_xor_si128(_mm_cmpgt_epi32(distance, limit), _mm_set1_epi32(-1)));
+			__m128 open = _mm_cmpge_ps(_mm_loadu_ps(weights + i), zero);
+			__m128 availableMask = _mm_and_ps(fits, open);
+
+			__m128 info = _mm_loadu_ps(choiceInfo + i);
+			__m128 weight = _mm_and_ps(availableMask, _mm_max_ps(info, _mm_mul_ps(info, floorScale)));
+			_mm_storeu_ps(weights + i, _mm_or_ps(weight, _mm_andnot_ps(availableMask, unavailable)));
+			sums = _mm_add_ps(sums, weight);
+			counts = _mm_sub_epi32(counts, _mm_castps_si128(availableMask));
+		}
+
+		float sumLanes[4];
+		int countLanes[4];
+		_mm_storeu_ps(sumLanes, sums);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(countLanes), counts);
+		weightsSum = (sumLanes[0] + sumLanes[1]) + (sumLanes[2] + sumLanes[3]);
+		available = countLanes[0] + countLanes[1] + countLanes[2] + countLanes[3];
+#endif
+
+		for (; i < size; i++) {
+			bool isAvailable = weights[i] >= 0.f && distances[i] <= remainingLength;
+			float weight = std::max(choiceInfo[i], -choiceInfo[i] * floorWeight);
+			weights[i] = isAvailable ? weight : -1.f;
+			weightsSum += isAvailable ? weight : 0.f;
+			available += isAvailable;
+		}
+
+		availableVertices = available;
+		return weightsSum;
+	}
 
-	m_Pheromone = std::vector<std::vector<float>>(size + 1, std::vector<float>(size, 1.f));
-	m_PheromoneDeposited = std::vector<std::vector<float>>(size + 1, std::vector<float>(size, 0.f));
-	m_Weights = std::vector<float>(size, 1.f);
 }
 
-AntColony::~AntColony() {}
+AntColony::AntColony(const Instance& instance, const Parameters& parameters, ThreadPool* threadPool, Buffers* buffers)
+	: m_Instance(instance), m_Parameters(parameters), m_ThreadPool(threadPool), m_Buffers(buffers) {
+	int size = m_Instance.oligonucleotides.size();
 
-std::vector<int> AntColony::Run() {
+	if (m_Buffers) {
+		m_Pheromone = std::move(m_Buffers->Pheromone);
+		m_DepositFlags = std::move(m_Buffers->DepositFlags);
+		m_ChoiceInfo = std::move(m_Buffers->ChoiceInfo);
+		m_ChoiceTree = std::move(m_Buffers->ChoiceTree);
+		m_ChoiceTotals = std::move(m_Buffers->ChoiceTotals);
+		m_FloorTree = std::move(m_Buffers->FloorTree);
+		m_FloorTotals = std::move(m_Buffers->FloorTotals);
+		m_Workspaces = std::move(m_Buffers->Workspaces);
+	}
 
-	for (int i = 0; i < m_Parameters.Iterations; i++) {
-		Iteration();
+	if (!m_ThreadPool && m_Parameters.Threads != 1) {
+		m_OwnThreadPool = std::make_unique<ThreadPool>(m_Parameters.Threads);
+		m_ThreadPool = m_OwnThreadPool.get();
+	}
+	int threads = m_ThreadPool ? (int)m_ThreadPool->size() : 1;
+
+	m_Pheromone.assign(size + 1, size, 1.f);
+	m_Pheromone.setBounds(m_Parameters.PheromoneMin, m_Parameters.PheromoneMax);
+	// keeps pow(stored, Alpha) summed over a row far below FLT_MAX
+	m_MinimumPheromoneScale = std::pow(1e-24f, 1.f / std::max(m_Parameters.Alpha, 1.f));
+	m_DepositFlags.assign((size_t)(size + 1) * size, false);
+
+	// distances are bytes, so the heuristic is a table over every possible weight
+	m_Heuristic = std::vector<float>(OverlapMatrix::NO_EDGE + 1, 0.f);
+	for (int d = 1; d < OverlapMatrix::NO_EDGE; d++) {
+		m_Heuristic[d] = std::pow(1.f / (float)d, m_Parameters.Beta);
+	}
+	m_StartDistances = std::vector<OverlapMatrix::Weight>(size);
+	for (int i = 0; i < size; i++) {
+		m_StartDistances[i] = (OverlapMatrix::Weight)m_Instance.startLength(i);
+	}
+	// the weight into a compacted chain includes the chain, the heuristic only sees the
+	// overlap into its first oligonucleotide, as an ant on the full spectrum would
+	if (!m_Instance.chainStarts.empty()) {
+		m_ChainOffsets = std::vector<OverlapMatrix::Weight>(size);
+		for (int i = 0; i < size; i++) {
+			m_ChainOffsets[i] = (OverlapMatrix::Weight)(m_Instance.chainLength(i) - 1);
+		}
+	}
+	m_ChoiceInfo.assign((size_t)(size + 1) * size, 0.f);
+	m_ChoiceTree.assign((size_t)(size + 1) * size, 0.f);
+	m_ChoiceTotals.assign(size + 1, 0.f);
+	m_FloorTree.clear();
+	m_FloorTotals.clear();
+	if (m_Parameters.PheromoneMin > 0.f) {
+		m_FloorTree.assign((size_t)(size + 1) * size, 0.f);
+		m_FloorTotals.assign(size + 1, 0.f);
+		m_FloorWeight = std::pow(m_Pheromone.storedFloor(), m_Parameters.Alpha);
+		// every trail no ant walked yet evaporates alike from the initial value
+		float initial = std::max(1.f, m_Parameters.PheromoneMin);
+		if (m_Parameters.PheromoneMax > 0.f) {
+			initial = std::min(initial, m_Parameters.PheromoneMax);
+		}
+		if (initial > m_Parameters.PheromoneMin) {
+			m_UntouchedFloorIteration = FloorIterations(initial);
+		}
+	}
+	m_ChoiceTreeTop = 1;
+	while (m_ChoiceTreeTop * 2 <= size) {
+		m_ChoiceTreeTop *= 2;
+	}
 
-		LOG_TRACE("ant colony: {} / {}", i + 1, m_Parameters.Iterations);
+	bool alphaOne = m_Parameters.Alpha == 1.f;
+	bool betaOne = m_Parameters.Beta == 1.f;
+	if (alphaOne && betaOne) {
+		m_RefreshChoiceInfo = &AntColony::RefreshChoiceInfo<true, true>;
+	}
+	else if (alphaOne) {
+		m_RefreshChoiceInfo = &AntColony::RefreshChoiceInfo<true, false>;
+	}
+	else if (betaOne) {
+		m_RefreshChoiceInfo = &AntColony::RefreshChoiceInfo<false, true>;
+	}
+	else {
+		m_RefreshChoiceInfo = &AntColony::RefreshChoiceInfo<false, false>;
+	}
+	(this->*m_RefreshChoiceInfo)(0, size + 1);
+
+	m_Workspaces.resize(threads);
+	for (int t = 0; t < threads; t++) {
+		Workspace& workspace = m_Workspaces[t];
+		workspace.Weights.assign(size, 1.f);
+		workspace.Available.clear();
+		workspace.Available.reserve(size);
+		workspace.Listed = false;
+		workspace.CandidateWeights.assign(m_Instance.candidates.maxCandidates(), 0.f);
+		workspace.Deposits.clear();
+		workspace.Deposits.reserve((m_Parameters.Ants / threads + 1) * (size + 1));
+		workspace.Path.clear();
+		workspace.Path.reserve(size + 1);
+		workspace.PathOligonucleotides = 0;
+		workspace.BestPath.clear();
+		workspace.BestPath.reserve(size + 1);
+		workspace.BestPathOligonucleotides = 0;
+		workspace.Random = CounterRng(m_Parameters.Seed, t);
+	}
+}
+
+AntColony::~AntColony() {
+	if (m_Buffers) {
+		m_Buffers->Pheromone = std::move(m_Pheromone);
+		m_Buffers->DepositFlags = std::move(m_DepositFlags);
+		m_Buffers->ChoiceInfo = std::move(m_ChoiceInfo);
+		m_Buffers->ChoiceTree = std::move(m_ChoiceTree);
+		m_Buffers->ChoiceTotals = std::move(m_ChoiceTotals);
+		m_Buffers->FloorTree = std::move(m_FloorTree);
+		m_Buffers->FloorTotals = std::move(m_FloorTotals);
+		m_Buffers->Workspaces = std::move(m_Workspaces);
+	}
+}
+
+std::vector<int> AntColony::Run(const StopCondition& stop) {
+
+	while (Step(stop)) {
 	}
 
 	// LOG_TRACE("pheromone:{}", PheromeneToString());
 
-	return Result();
+	return Best();
+}
+
+bool AntColony::Step(const StopCondition& stop) {
+	if (m_Iteration >= (uint32_t)m_Parameters.Iterations) {
+		return false;
+	}
+	if (stop.stopRequested()) {
+		LOG_TRACE("ant colony: stopped after {} iterations", m_Iteration);
+		return false;
+	}
+	if (m_Instance.bestSolutionSize > 0 && m_BestPathOligonucleotides >= m_Instance.bestSolutionSize) {
+		LOG_TRACE("ant colony: reached {} oligonucleotides", m_BestPathOligonucleotides);
+		return false;
+	}
+	if (m_Parameters.StagnationIterations > 0 && m_Iteration - m_BestPathIteration >= (uint32_t)m_Parameters.StagnationIterations) {
+		LOG_TRACE("ant colony: no improvement for {} iterations", m_Parameters.StagnationIterations);
+		return false;
+	}
+
+	Iteration();
+
+	LOG_TRACE("ant colony: {} / {}", m_Iteration, m_Parameters.Iterations);
+	return true;
+}
+
+std::vector<int> AntColony::Best() {
+	std::vector<int> result = Result();
+	if (m_BestPathOligonucleotides > m_Instance.countOligonucleotides(result)) {
+		return m_BestPath;
+	}
+	return result;
+}
+
+void AntColony::Reinforce(const std::vector<int>& path, float weight) {
+	int size = m_Instance.oligonucleotides.size();
+
+	// same amount as an ant's deposit, walked from the start vertex's row
+	size_t oligonucleotides = m_Instance.countOligonucleotides(path);
+	float amount = weight * (float)oligonucleotides / (float)m_Instance.bestSolutionSize;
+	int previous = size;
+	for (int vertex : path) {
+		m_Pheromone.deposit(previous, vertex, amount);
+		UpdateChoiceInfo(previous, vertex);
+		ScheduleFloorCheck((size_t)previous * size + vertex);
+		previous = vertex;
+	}
+
+	if (oligonucleotides > m_BestPathOligonucleotides) {
+		m_BestPath = path;
+		m_BestPathOligonucleotides = oligonucleotides;
+		m_BestPathIteration = m_Iteration;
+	}
 }
 
 void AntColony::Iteration() {
 	int size = m_Instance.oligonucleotides.size();
+	int threads = m_Workspaces.size();
+	SolverMetrics::Clock::time_point phaseStart;
+	if (m_Metrics) {
+		phaseStart = SolverMetrics::Clock::now();
+	}
 
-	// pheromene deposited
-	for (int i = 0; i < size + 1; i++) {
-		for (int j = 0; j < size; j++) {
-			m_PheromoneDeposited[i][j] = (0.f);
+	// every thread builds a fixed share of the ants with its own random stream and
+	// records its deposits in its own list
+	auto buildAnts = [&](size_t t) {
+		Workspace& workspace = m_Workspaces[t];
+		workspace.Deposits.clear();
+		workspace.BestPath.clear();
+		workspace.BestPathOligonucleotides = 0;
+
+		int firstAnt = m_Parameters.Ants * t / threads;
+		int lastAnt = m_Parameters.Ants * (t + 1) / threads;
+		for (int a = firstAnt; a < lastAnt; a++) {
+			ConstructPath(workspace);
+
+			// calculate added pheromone
+			const std::vector<int>& path = workspace.Path;
+			if (workspace.PathOligonucleotides > workspace.BestPathOligonucleotides) {
+				workspace.BestPath = path;
+				workspace.BestPathOligonucleotides = workspace.PathOligonucleotides;
+			}
+
+			float amount = (float)workspace.PathOligonucleotides / (float)m_Instance.bestSolutionSize;
+			for (size_t i = 1; i < path.size(); i++) {
+				workspace.Deposits.emplace_back((size_t)path[i - 1] * size + path[i], amount);
+			}
 		}
+	};
+
+	if (m_ThreadPool) {
+		m_ThreadPool->parallelFor(threads, buildAnts);
+	}
+	else {
+		buildAnts(0);
+	}
+
+	if (m_Metrics) {
+		SolverMetrics::add(m_Metrics->antsBuilt, m_Parameters.Ants);
+		SolverMetrics::addElapsed(m_Metrics->antNanoseconds, phaseStart);
+		phaseStart = SolverMetrics::Clock::now();
 	}
 
-	for (int a = 0; a < m_Parameters.Ants; a++) {
-		int size = m_Instance.oligonucleotides.size();
+	// update pheromone, evaporation is O(1) and the deposits are applied in thread order
+	// so a seed gives the same result
+	bool renormalised = m_Pheromone.evaporate(m_Parameters.Evaporation, m_MinimumPheromoneScale);
 
-		int pathLength = 0;
-		int currentVertex = size;
+	m_Iteration++;
+	if (!m_FloorTree.empty()) {
+		m_FloorWeight = std::pow(m_Pheromone.storedFloor(), m_Parameters.Alpha);
+	}
+	for (const Workspace& workspace : m_Workspaces) {
+		// paths begin with the start vertex
+		if (workspace.BestPathOligonucleotides > m_BestPathOligonucleotides) {
+			m_BestPath.assign(workspace.BestPath.begin() + 1, workspace.BestPath.end());
+			m_BestPathOligonucleotides = workspace.BestPathOligonucleotides;
+			m_BestPathIteration = m_Iteration;
+		}
+	}
 
-		std::vector<int> path;
-		path.push_back(currentVertex);
+	m_Deposited.clear();
+	for (const Workspace& workspace : m_Workspaces) {
+		for (auto [entry, amount] : workspace.Deposits) {
+			m_Pheromone.deposit(entry / size, entry % size, amount);
+			if (!m_DepositFlags[entry]) {
+				m_DepositFlags[entry] = true;
+				m_Deposited.push_back(entry);
+			}
+		}
+	}
+	for (size_t entry : m_Deposited) {
+		m_DepositFlags[entry] = false;
+	}
 
-		for (int i = 0; i < size; i++) {
-			m_Weights[i] = 1.f;
+	// Evaporation scales every stored value alike, so only deposited entries change
+	// their choice info, unless the buffer was renormalised. Trails at the MAX-MIN
+	// floor follow it through m_FloorWeight, the ones reaching it move there below,
+	// except the trails no ant walked yet, which reach it together and all at once.
+	// Point updates cost O(log s) each, so very dense deposits rebuild everything.
+	int treeDepth = 1;
+	while ((1 << treeDepth) < size) {
+		treeDepth++;
+	}
+	// and once more in case rounding put the predicted iteration early
+	bool untouchedFloored = m_UntouchedFloorIteration > 0
+		&& (m_Iteration == m_UntouchedFloorIteration || m_Iteration == m_UntouchedFloorIteration + 1);
+	bool refreshAll = renormalised || untouchedFloored
+		|| (long long)m_Deposited.size() * treeDepth >= (long long)(size + 1) * size;
+
+	if (refreshAll) {
+		auto refreshRows = [&](size_t t) {
+			(this->*m_RefreshChoiceInfo)((size + 1) * t / threads, (size + 1) * (t + 1) / threads);
+		};
+		if (m_ThreadPool) {
+			m_ThreadPool->parallelFor(threads, refreshRows);
+		}
+		else {
+			refreshRows(0);
+		}
+	}
+	else {
+		for (size_t entry : m_Deposited) {
+			UpdateChoiceInfo(entry / size, entry % size);
+		}
+	}
+
+	if (!m_FloorTree.empty()) {
+		for (size_t entry : m_Deposited) {
+			ScheduleFloorCheck(entry);
 		}
+		RunFloorChecks();
+	}
 
-		// generate ant path
-		while (true) {
-			//std::map<int, float> weights;
-			float weightsSum = 0;
+	if (m_Metrics) {
+		SolverMetrics::add(m_Metrics->pheromoneUpdates, 1);
+		SolverMetrics::addElapsed(m_Metrics->pheromoneNanoseconds, phaseStart);
+	}
+}
 
-			// calculate weights for available edges
-			int availableVertices = 0;
+template <bool AlphaOne, bool BetaOne>
+void AntColony::RefreshChoiceInfo(int firstRow, int lastRow) {
+	int size = m_Instance.oligonucleotides.size();
+	bool bounded = !m_FloorTree.empty();
 
-			for (int i = 0; i < size; i++) {
-				if (m_Weights[i] < 0.f) {
-					continue;
-				}
+	for (int i = firstRow; i < lastRow; i++) {
+		const float* pheromone = m_Pheromone.storedRow(i);
+		float floor = m_Pheromone.storedFloor();
+		const OverlapMatrix::Weight* distances = i == size ? m_StartDistances.data() : m_Instance.adjMatrix.row(i);
+		float* choiceInfo = m_ChoiceInfo.data() + (size_t)i * size;
 
-				// distance from current vertex and available vertex
-				int distance = currentVertex == size ? m_Instance.l : m_Instance.adjMatrix[currentVertex][i];
+		for (int j = 0; j < size; j++) {
+			float trail = std::max(pheromone[j], floor);
+			float attractiveness = AlphaOne ? trail : std::pow(trail, m_Parameters.Alpha);
+			int distance = HeuristicDistance(distances[j], j);
+			float heuristic = BetaOne ? 1.f / (float)distance : m_Heuristic[distance];
+			choiceInfo[j] = bounded && pheromone[j] <= floor ? -heuristic : attractiveness * heuristic;
+		}
 
-				if (pathLength + distance > m_Instance.n) {
-					m_Weights[i] = -1.f;
-					continue;
-				}
+		float* tree = m_ChoiceTree.data() + (size_t)i * size;
+		for (int j = 0; j < size; j++) {
+			tree[j] = std::max(choiceInfo[j], 0.f);
+		}
+		m_ChoiceTotals[i] = BuildTree(tree, size);
 
-				// calculate weight of edge
-				float weight = std::powf(m_Pheromone[currentVertex][i], m_Parameters.Alpha) * std::powf(1.f / (float)distance, m_Parameters.Beta);
-				m_Weights[i] = weight;
-				weightsSum += weight;
-				availableVertices++;
+		if (bounded) {
+			float* floorTree = m_FloorTree.data() + (size_t)i * size;
+			for (int j = 0; j < size; j++) {
+				floorTree[j] = std::max(-choiceInfo[j], 0.f);
 			}
+			m_FloorTotals[i] = BuildTree(floorTree, size);
+		}
+	}
+}
 
-			// end when there are no more available edges
-			if (availableVertices == 0) {
-				break;
+float AntColony::BuildTree(float* tree, int size) {
+	// linear time Fenwick tree construction over the leaves in place, node k (1-based)
+	// is stored at k - 1
+	for (int k = 1; k <= size; k++) {
+		int parent = k + (k & -k);
+		if (parent <= size) {
+			tree[parent - 1] += tree[k - 1];
+		}
+	}
+
+	float total = 0.f;
+	for (int k = size; k > 0; k -= k & -k) {
+		total += tree[k - 1];
+	}
+	return total;
+}
+
+void AntColony::UpdateChoiceInfo(int row, int column) {
+	int size = m_Instance.oligonucleotides.size();
+	int distance = HeuristicDistance(row == size ? m_StartDistances[column] : m_Instance.adjMatrix(row, column), column);
+
+	float stored = m_Pheromone.stored(row, column);
+	float floor = m_Pheromone.storedFloor();
+	float trail = std::max(stored, floor);
+	float attractiveness = m_Parameters.Alpha == 1.f ? trail : std::pow(trail, m_Parameters.Alpha);
+	float heuristic = m_Parameters.Beta == 1.f ? 1.f / (float)distance : m_Heuristic[distance];
+
+	// a trail moves between the two trees when it leaves or reaches the floor
+	bool floored = !m_FloorTree.empty() && stored <= floor;
+	float& choiceInfo = m_ChoiceInfo[(size_t)row * size + column];
+	float info = floored ? -heuristic : attractiveness * heuristic;
+	float delta = std::max(info, 0.f) - std::max(choiceInfo, 0.f);
+	float floorDelta = std::max(-info, 0.f) - std::max(-choiceInfo, 0.f);
+	choiceInfo = info;
+
+	if (delta != 0.f) {
+		float* tree = m_ChoiceTree.data() + (size_t)row * size;
+		for (int k = column + 1; k <= size; k += k & -k) {
+			tree[k - 1] += delta;
+		}
+		m_ChoiceTotals[row] += delta;
+	}
+	if (floorDelta != 0.f) {
+		float* tree = m_FloorTree.data() + (size_t)row * size;
+		for (int k = column + 1; k <= size; k += k & -k) {
+			tree[k - 1] += floorDelta;
+		}
+		m_FloorTotals[row] += floorDelta;
+	}
+}
+
+uint32_t AntColony::FloorIterations(float trail) const {
+	// a trail left alone loses the factor 1 - Evaporation every iteration
+	float rate = m_Parameters.Evaporation;
+	if (trail <= m_Parameters.PheromoneMin || rate >= 1.f) {
+		return 1;
+	}
+	if (rate <= 0.f) {
+		return UINT32_MAX / 2;
+	}
+	double iterations = std::ceil(std::log((double)m_Parameters.PheromoneMin / trail) / std::log(1.0 - rate));
+	return (uint32_t)std::clamp(iterations, 1.0, (double)(UINT32_MAX / 2));
+}
+
+void AntColony::ScheduleFloorCheck(size_t entry) {
+	if (m_FloorTree.empty()) {
+		return;
+	}
+
+	int size = m_Instance.oligonucleotides.size();
+	float trail = m_Pheromone.value(entry / size, entry % size);
+	uint32_t iteration = m_Iteration + std::min(FloorIterations(trail), UINT32_MAX / 2 - m_Iteration);
+	m_FloorChecks.push_back(FloorCheck{ iteration, entry });
+	std::push_heap(m_FloorChecks.begin(), m_FloorChecks.end(), [](const FloorCheck& a, const FloorCheck& b) {
+		return a.Iteration > b.Iteration;
+	});
+}
+
+void AntColony::RunFloorChecks() {
+	int size = m_Instance.oligonucleotides.size();
+	auto later = [](const FloorCheck& a, const FloorCheck& b) {
+		return a.Iteration > b.Iteration;
+	};
+
+	// a check is stale once an ant deposited on its entry again, that left a newer one:
+	// a trail found above the floor is only checked again when rounding can explain it
+	while (!m_FloorChecks.empty() && m_FloorChecks.front().Iteration <= m_Iteration) {
+		std::pop_heap(m_FloorChecks.begin(), m_FloorChecks.end(), later);
+		FloorCheck check = m_FloorChecks.back();
+		m_FloorChecks.pop_back();
+		if (m_ChoiceInfo[check.Entry] < 0.f) {
+			continue;
+		}
+
+		int row = (int)(check.Entry / size);
+		int column = (int)(check.Entry % size);
+		if (m_Pheromone.stored(row, column) <= m_Pheromone.storedFloor()) {
+			UpdateChoiceInfo(row, column);
+		}
+		else if (FloorIterations(m_Pheromone.value(row, column)) <= 1) {
+			// rounding put the predicted iteration early
+			ScheduleFloorCheck(check.Entry);
+		}
+	}
+}
+
+void AntColony::ConstructPath(Workspace& workspace) {
+	int size = m_Instance.oligonucleotides.size();
+
+	int pathLength = 0;
+	int currentVertex = size;
+
+	std::vector<int>& path = workspace.Path;
+	path.clear();
+	path.push_back(currentVertex);
+	workspace.PathOligonucleotides = 0;
+
+	for (int i = 0; i < size; i++) {
+		workspace.Weights[i] = 1.f;
+	}
+	workspace.Listed = false;
+
+	// draws cost O(log s) each, not worth it once the listed vertices are fewer
+	int treeDepth = 1;
+	while ((1 << treeDepth) < size) {
+		treeDepth++;
+	}
+	size_t drawCost = (size_t)m_Parameters.SamplingAttempts * treeDepth;
+
+	// generate ant path
+	while (true) {
+		const OverlapMatrix::Weight* distances = currentVertex == size ? nullptr : m_Instance.adjMatrix.row(currentVertex);
+
+		// restricted to the best successors first, full scan when none of them fits
+		int nextVertex = -1;
+		if (m_Parameters.UseCandidateLists && currentVertex != size) {
+			nextVertex = SelectCandidate(workspace, currentVertex, pathLength);
+		}
+
+		if (nextVertex == -1 && (!workspace.Listed || workspace.Available.size() > drawCost)) {
+			nextVertex = SampleVertex(workspace, currentVertex, pathLength);
+		}
+
+		if (nextVertex == -1) {
+			nextVertex = SelectVertex(workspace, currentVertex, pathLength);
+		}
+
+		// end when there are no more available edges
+		if (nextVertex == -1) {
+			break;
+		}
+
+		path.push_back(nextVertex);
+		workspace.PathOligonucleotides += m_Instance.chainLength(nextVertex);
+		pathLength += currentVertex == size ? m_StartDistances[nextVertex] : distances[nextVertex];
+		workspace.Weights[nextVertex] = -1.f;
+		currentVertex = nextVertex;
+	}
+}
+
+int AntColony::SampleVertex(Workspace& workspace, int currentVertex, int pathLength) {
+	int size = m_Instance.oligonucleotides.size();
+	std::vector<float>& weights = workspace.Weights;
+	const OverlapMatrix::Weight* distances = currentVertex == size ? m_StartDistances.data() : m_Instance.adjMatrix.row(currentVertex);
+	size_t row = (size_t)currentVertex * size;
+	float liveTotal = m_ChoiceTotals[currentVertex];
+	float floorTotal = m_FloorTree.empty() ? 0.f : m_FloorWeight * m_FloorTotals[currentVertex];
+
+	// Draws from the whole row in O(log s) and rejects vertices that are taken or do
+	// not fit. Accepted draws follow exactly the distribution over the available
+	// vertices, only once most of the row weight is taken do the draws keep failing
+	// and the caller falls back to the full scan. Trails at the MAX-MIN floor are
+	// drawn from their own tree, by their share of the row.
+	for (int attempt = 0; attempt < m_Parameters.SamplingAttempts; attempt++) {
+		float random = workspace.Random.nextFloat() * (liveTotal + floorTotal);
+		const float* tree = m_ChoiceTree.data() + row;
+		if (random >= liveTotal && floorTotal > 0.f) {
+			tree = m_FloorTree.data() + row;
+			random = (random - liveTotal) / m_FloorWeight;
+		}
+
+		int position = 0;
+		for (int step = m_ChoiceTreeTop; step > 0; step /= 2) {
+			if (position + step <= size && tree[position + step - 1] <= random) {
+				position += step;
+				random -= tree[position - 1];
 			}
+		}
+
+		int vertex = position;
+		if (vertex >= size || weights[vertex] < 0.f) {
+			continue;
+		}
+
+		if (pathLength + distances[vertex] > (int)m_Instance.n) {
+			weights[vertex] = -1.f;
+			continue;
+		}
+
+		return vertex;
+	}
+
+	return -1;
+}
 
-			// select random edge
-			int nextVertex = -1;
-			float random = (float)rand() / (float)RAND_MAX * weightsSum;
+int AntColony::SelectVertex(Workspace& workspace, int currentVertex, int pathLength) {
+	int size = m_Instance.oligonucleotides.size();
+	std::vector<float>& weights = workspace.Weights;
+	std::vector<int>& available = workspace.Available;
+	const OverlapMatrix::Weight* distances = currentVertex == size ? m_StartDistances.data() : m_Instance.adjMatrix.row(currentVertex);
+	const float* choiceInfo = m_ChoiceInfo.data() + (size_t)currentVertex * size;
+
+	if (!workspace.Listed) {
+		// calculate weights for available edges
+		int availableVertices = 0;
+		float weightsSum = AccumulateWeights(choiceInfo, m_FloorWeight, distances, m_Instance.n - pathLength,
+			weights.data(), size, availableVertices);
+
+		if (availableVertices == 0) {
+			return -1;
+		}
+
+		// Late in a path the draws keep failing and every step would scan the whole
+		// row, so once few vertices are left the later scans only visit those.
+		if (availableVertices * 4 < size) {
+			available.clear();
 			for (int i = 0; i < size; i++) {
-				if (m_Weights[i] < 0.f) {
-					continue;
-				}
-				random -= m_Weights[i];
-				if (random < 0.f) {
-					nextVertex = i;
-					break;
+				if (weights[i] >= 0.f) {
+					available.push_back(i);
 				}
 			}
-			if (nextVertex == -1) {
-				for (int i = 0; i < size; i++) {
-					if (m_Weights[i] >= 0.f) {
-						nextVertex = i;
-						break;
-					}
-				}
+			workspace.Listed = true;
+		}
+
+		// select random edge, the last available vertex absorbs rounding errors
+		int nextVertex = -1;
+		float random = workspace.Random.nextFloat() * weightsSum;
+		for (int i = 0; i < size; i++) {
+			if (weights[i] < 0.f) {
+				continue;
 			}
+			nextVertex = i;
+			random -= weights[i];
+			if (random < 0.f) {
+				break;
+			}
+		}
 
-			path.push_back(nextVertex);
-			pathLength += currentVertex == size ? m_Instance.l : m_Instance.adjMatrix[currentVertex][nextVertex];
-			m_Weights[nextVertex] = -1.f;
-			currentVertex = nextVertex;
+		return nextVertex;
+	}
+
+	// the path only gets longer, so a vertex out of reach leaves the list for good
+	float weightsSum = 0.f;
+	for (size_t k = 0; k < available.size();) {
+		int vertex = available[k];
+		if (weights[vertex] < 0.f || pathLength + distances[vertex] > (int)m_Instance.n) {
+			weights[vertex] = -1.f;
+			available[k] = available.back();
+			available.pop_back();
+			continue;
 		}
 
-		// calculate added pheromone
-		for (int i = 0; i < path.size() - 1; i++) {
-			m_PheromoneDeposited[path[i]][path[i + 1]] += (float)path.size() / (float)m_Instance.bestSolutionSize;
+		float weight = std::max(choiceInfo[vertex], -choiceInfo[vertex] * m_FloorWeight);
+		weights[vertex] = weight;
+		weightsSum += weight;
+		k++;
+	}
+
+	if (available.empty()) {
+		return -1;
+	}
+
+	int nextVertex = -1;
+	float random = workspace.Random.nextFloat() * weightsSum;
+	for (int vertex : available) {
+		nextVertex = vertex;
+		random -= weights[vertex];
+		if (random < 0.f) {
+			break;
 		}
 	}
 
+	return nextVertex;
+}
 
-	// update pheromone
-	for (int i = 0; i < size + 1; i++) {
-		for (int j = 0; j < size; j++) {
-			m_Pheromone[i][j] = (1.f - m_Parameters.Evaporation) * m_Pheromone[i][j] + m_PheromoneDeposited[i][j];
+int AntColony::SelectCandidate(Workspace& workspace, int currentVertex, int pathLength) {
+	int size = m_Instance.oligonucleotides.size();
+	std::vector<float>& weights = workspace.Weights;
+	std::vector<float>& candidateWeights = workspace.CandidateWeights;
+	const CandidateLists& candidates = m_Instance.candidates;
+	const int count = candidates.count(currentVertex);
+	const uint32_t* vertices = candidates.vertices(currentVertex);
+	const OverlapMatrix::Weight* distances = candidates.weights(currentVertex);
+
+	float weightsSum = 0;
+	for (int c = 0; c < count; c++) {
+		int vertex = vertices[c];
+		candidateWeights[c] = 0.f;
+		if (weights[vertex] < 0.f) {
+			continue;
+		}
+
+		if (pathLength + distances[c] > (int)m_Instance.n) {
+			weights[vertex] = -1.f;
+			continue;
 		}
+
+		float weight = m_ChoiceInfo[(size_t)currentVertex * size + vertex];
+		weight = std::max(weight, -weight * m_FloorWeight);
+		candidateWeights[c] = weight;
+		weightsSum += weight;
 	}
 
+	if (weightsSum <= 0.f) {
+		return -1;
+	}
 
+	// select random edge, the last available candidate absorbs rounding errors
+	int nextVertex = -1;
+	float random = workspace.Random.nextFloat() * weightsSum;
+	for (int c = 0; c < count; c++) {
+		if (candidateWeights[c] <= 0.f) {
+			continue;
+		}
+		nextVertex = vertices[c];
+		random -= candidateWeights[c];
+		if (random < 0.f) {
+			break;
+		}
+	}
 
+	return nextVertex;
 }
 
-
 std::vector<int> AntColony::Result() {
 	int size = m_Instance.oligonucleotides.size();
 
@@ -145,34 +754,35 @@ std::vector<int> AntColony::Result() {
 	int currentVertex = size;
 	std::vector<int> result;
 
-	std::set<int> availableVertices;
-	for (int i = 0; i < size; i++) {
-		availableVertices.insert(i);
-	}
+	// vertices still within reach, a vertex leaves by swapping with the last one
+	std::vector<int> availableVertices(size);
+	std::iota(availableVertices.begin(), availableVertices.end(), 0);
 
 	while (true) {
-		std::set<int> toRemove;
-		int nextVertex = 0;
-		int maxPheromone = 0;
+		int nextIndex = -1;
+		float maxPheromone = 0.f;
+		const OverlapMatrix::Weight* distances = currentVertex == size ? nullptr : m_Instance.adjMatrix.row(currentVertex);
 
-		for (int vertex : availableVertices) {
+		for (size_t k = 0; k < availableVertices.size();) {
+			int vertex = availableVertices[k];
 			// distance from current vertex and available vertex
-			int distance = currentVertex == size ? m_Instance.l : m_Instance.adjMatrix[currentVertex][vertex];
+			int distance = currentVertex == size ? m_StartDistances[vertex] : distances[vertex];
 
-			if (pathLength + distance > m_Instance.n) {
-				toRemove.insert(vertex);
+			// the path only gets longer, so a vertex out of reach stays out of reach
+			if (pathLength + distance > (int)m_Instance.n) {
+				availableVertices[k] = availableVertices.back();
+				availableVertices.pop_back();
 				continue;
 			}
 
-			if (m_Pheromone[currentVertex][vertex] > maxPheromone) {
-				nextVertex = vertex;
-				maxPheromone = m_Pheromone[currentVertex][vertex];
+			// the most pheromone, the lowest index among equal trails
+			float pheromone = m_Pheromone.value(currentVertex, vertex);
+			if (nextIndex < 0 || pheromone > maxPheromone
+				|| (pheromone == maxPheromone && vertex < availableVertices[nextIndex])) {
+				nextIndex = (int)k;
+				maxPheromone = pheromone;
 			}
-		}
-
-		// remove not available edges
-		for (int vertex : toRemove) {
-			availableVertices.erase(vertex);
+			k++;
 		}
 
 		// end when there are no more available edges
@@ -180,9 +790,11 @@ std::vector<int> AntColony::Result() {
 			break;
 		}
 
+		int nextVertex = availableVertices[nextIndex];
 		result.push_back(nextVertex);
-		pathLength += currentVertex == size ? m_Instance.l : m_Instance.adjMatrix[currentVertex][nextVertex];
-		availableVertices.erase(nextVertex);
+		pathLength += currentVertex == size ? m_StartDistances[nextVertex] : distances[nextVertex];
+		availableVertices[nextIndex] = availableVertices.back();
+		availableVertices.pop_back();
 		currentVertex = nextVertex;
 	}
 
@@ -197,7 +809,7 @@ std::string AntColony::PheromeneToString() const {
 	stream << '\n';
 	for (int i = 0; i < size + 1; i++) {
 		for (int j = 0; j < size; j++) {
-			stream << std::setw(15) << std::fixed << std::setprecision(3) << m_Pheromone[i][j];
+			stream << std::setw(15) << std::fixed << std::setprecision(3) << m_Pheromone.value(i, j);
 		}
 		stream << '\n';
 	}
@@ -1,5 +1,12 @@
 #pragma once
+#include <memory>
+
 #include "Instance.h"
+#include "Metrics.h"
+#include "Pheromone.h"
+#include "Random.h"
+#include "StopCondition.h"
+#include "ThreadPool.h"
 
 class AntColony {
 
@@ -10,28 +17,131 @@ public:
 		float Alpha; // pheromone influence
 		float Beta; // distance influence
 		float Evaporation; // pheromeno evaporation rate
+		bool UseCandidateLists = false; // choose among Instance::candidates before scanning every vertex
+		int Threads = 1; // threads building ants, 0 = one per hardware thread; ignored with a ThreadPool given
+		uint64_t Seed = 0; // same seed and thread count, the pool size with a ThreadPool, give the same run
+		int SamplingAttempts = 8; // O(log s) draws tried per step before the exact scan of the vertices left, 0 = always scan
+		float PheromoneMin = 0.f; // MAX-MIN bounds on the trails, 0 = unbounded
+		float PheromoneMax = 0.f;
+		int StagnationIterations = 0; // stop after this many iterations without a longer ant path, 0 = never
 
 		Parameters(int iterations, int ants, float alpha, float beta, float evaporation)
 			: Iterations(iterations), Ants(ants), Alpha(alpha), Beta(beta), Evaporation(evaporation) {}
 	};
 
+private:
+	struct Workspace;
+
+public:
+	// The O(size^2) storage of a colony. A colony given Buffers takes them over and
+	// hands them back when destroyed, so colonies run one after another reuse the
+	// memory instead of allocating it again.
+	struct Buffers {
+		PheromoneMatrix Pheromone;
+		std::vector<bool> DepositFlags;
+		std::vector<float> ChoiceInfo;
+		std::vector<float> ChoiceTree;
+		std::vector<float> ChoiceTotals;
+		std::vector<float> FloorTree;
+		std::vector<float> FloorTotals;
+		std::vector<Workspace> Workspaces;
+	};
+
 public:
-	AntColony(const Instance& instance, const Parameters& parameters);
+	// The colony runs on `threadPool` when given, with one thread per pool thread
+	// whatever Parameters::Threads says, otherwise on its own pool of
+	// Parameters::Threads. `buffers` are reused when given, see Buffers.
+	AntColony(const Instance& instance, const Parameters& parameters, ThreadPool* threadPool = nullptr,
+		Buffers* buffers = nullptr);
 	virtual ~AntColony();
 
-	std::vector<int> Run();
+	// Runs until Parameters::Iterations, `stop`, stagnation or a path of
+	// Instance::bestSolutionSize, and returns the best solution found.
+	std::vector<int> Run(const StopCondition& stop = StopCondition{});
+	// Runs one iteration unless Run would stop here, returns whether it did.
+	bool Step(const StopCondition& stop = StopCondition{});
+	// what Run returns: the longer of the best ant path and the greedy pheromone walk
+	std::vector<int> Best();
+	const std::vector<int>& BestPath() const { return m_BestPath; }
+
+	// Deposits on `path` (without the start vertex) as much pheromone as `weight` ants
+	// walking it would, and keeps it as the best path if it is longer. For paths found
+	// elsewhere, e.g. by another colony on the same instance.
+	void Reinforce(const std::vector<int>& path, float weight);
+
+	// counts ants and pheromone update time into `metrics` when not null
+	void SetMetrics(SolverMetrics* metrics) { m_Metrics = metrics; }
 	
 private:
+	// scratch owned by one thread while ants are built
+	struct Workspace {
+		std::vector<float> Weights;
+		std::vector<float> CandidateWeights;
+		std::vector<int> Available; // once Listed: every vertex not known to be taken or out of reach
+		bool Listed = false;
+		std::vector<std::pair<size_t, float>> Deposits; // (row * size + column, amount)
+		std::vector<int> Path;
+		size_t PathOligonucleotides = 0; // Instance::countOligonucleotides of Path
+		std::vector<int> BestPath; // longest path built in this iteration
+		size_t BestPathOligonucleotides = 0;
+		CounterRng Random;
+	};
+
 	void Iteration();
+	template <bool AlphaOne, bool BetaOne>
+	void RefreshChoiceInfo(int firstRow, int lastRow);
+	int HeuristicDistance(int distance, int column) const {
+		return m_ChainOffsets.empty() || distance == OverlapMatrix::NO_EDGE ? distance : distance - m_ChainOffsets[column];
+	}
+	static float BuildTree(float* tree, int size);
+	void UpdateChoiceInfo(int row, int column);
+	uint32_t FloorIterations(float trail) const;
+	void ScheduleFloorCheck(size_t entry);
+	void RunFloorChecks();
+	void ConstructPath(Workspace& workspace);
+	int SampleVertex(Workspace& workspace, int currentVertex, int pathLength);
+	int SelectVertex(Workspace& workspace, int currentVertex, int pathLength);
+	int SelectCandidate(Workspace& workspace, int currentVertex, int pathLength);
 	std::vector<int> Result();
 	std::string PheromeneToString() const;
 	
 private:
 	const Instance& m_Instance;
-	const Parameters& m_Parameters;
-	std::vector<std::vector<float>> m_Pheromone;
-	std::vector<std::vector<float>> m_PheromoneDeposited;
-	std::vector<float> m_Weights;
+	const Parameters m_Parameters;
+	PheromoneMatrix m_Pheromone; // (size + 1) x size, the last row leaves the start vertex
+	float m_MinimumPheromoneScale;
+	std::vector<bool> m_DepositFlags; // one bit per entry, set only while m_Deposited is collected
+	std::vector<size_t> m_Deposited; // entries deposited on in this iteration
+	uint32_t m_Iteration = 0;
+	std::vector<int> m_BestPath; // longest path any ant built so far, without the start vertex
+	size_t m_BestPathOligonucleotides = 0;
+	uint32_t m_BestPathIteration = 0;
+	std::vector<float> m_Heuristic; // pow(1 / d, Beta) for every weight d
+	// pow(pheromone, Alpha) * heuristic, (size + 1) x size; with MAX-MIN bounds a trail
+	// at the floor stores minus its heuristic instead, its weight is m_FloorWeight times that
+	std::vector<float> m_ChoiceInfo;
+	std::vector<float> m_ChoiceTree; // Fenwick tree over every row of m_ChoiceInfo above zero
+	std::vector<float> m_ChoiceTotals; // sum of every row of m_ChoiceTree
+	std::vector<float> m_FloorTree; // Fenwick tree over the heuristics of the trails at the floor, bounded only
+	std::vector<float> m_FloorTotals;
+	float m_FloorWeight = 0.f; // pow(stored floor, Alpha)
+
+	// when a trail no ant walks any more reaches the floor
+	struct FloorCheck {
+		uint32_t Iteration;
+		size_t Entry;
+	};
+	std::vector<FloorCheck> m_FloorChecks; // min-heap by Iteration
+	uint32_t m_UntouchedFloorIteration = 0; // when the trails no ant walked reach the floor
+	int m_ChoiceTreeTop; // highest power of two <= size
+	std::vector<OverlapMatrix::Weight> m_StartDistances; // distances from the start vertex, l + chain length - 1
+	std::vector<OverlapMatrix::Weight> m_ChainOffsets; // chain length - 1 of every vertex, empty unless compacted
+	void (AntColony::*m_RefreshChoiceInfo)(int firstRow, int lastRow);
+	std::vector<Workspace> m_Workspaces;
+	std::unique_ptr<ThreadPool> m_OwnThreadPool;
+	ThreadPool* m_ThreadPool;
+	SolverMetrics* m_Metrics = nullptr;
+	Buffers* m_Buffers; // where the storage goes back to, or null
 
 };
 
@@ -0,0 +1,100 @@
+#include "Batch.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "Logger.h"
+#include "Timer.h"
+
+void ResultCollector::add(BatchResult result)
+{
+    std::lock_guard<std::mutex> lock{ mutex };
+    collected.push_back(std::move(result));
+}
+
+std::vector<BatchResult> ResultCollector::results() const
+{
+    std::vector<BatchResult> sorted;
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        sorted = collected;
+    }
+
+    std::sort(sorted.begin(), sorted.end(),
+        [](const BatchResult& a, const BatchResult& b) { return a.name < b.name; });
+    return sorted;
+}
+
+BatchResult solveInstance(const std::string& name, const std::function<Instance()>& load,
+    const SequencerFactory& makeSequencer, std::chrono::milliseconds budget)
+{
+    std::unique_ptr<Sequencer> sequencer;
+    try
+    {
+        sequencer = makeSequencer();
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("{}: {}", name, e.what());
+        BatchResult result;
+        result.name = name;
+        result.error = e.what();
+        return result;
+    }
+    return solveInstance(name, load, *sequencer, budget);
+}
+
+BatchResult solveInstance(const std::string& name, const std::function<Instance()>& load, Sequencer& sequencer,
+    std::chrono::milliseconds budget)
+{
+    BatchResult result;
+    result.name = name;
+    SolverMetrics metrics;
+    try
+    {
+        SolverMetrics::Clock::time_point loadStart = SolverMetrics::Clock::now();
+        Instance instance = load();
+        SolverMetrics::addElapsed(metrics.loadNanoseconds, loadStart);
+        LOG_INFO("Loaded {}", name);
+        result.name = instance.name;
+        result.bestSolutionSize = instance.bestSolutionSize;
+
+        Timer timer;
+        timer.start();
+        result.used = sequencer.run(instance, budget.count() > 0 ? StopCondition::after(budget) : StopCondition{},
+            &metrics);
+        result.milliseconds = timer.elapsedMilliseconds();
+        result.sequence = instance.output(sequencer.getSolution());
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("{}: {}", name, e.what());
+        result.error = e.what();
+    }
+    result.metrics = metrics.toJson(result.name);
+    return result;
+}
+
+void runBatch(std::vector<std::filesystem::path> files, const SequencerFactory& makeSequencer, ThreadPool& pool,
+    ResultCollector& results, std::chrono::milliseconds budget, const InstanceOptions& options)
+{
+    std::vector<std::pair<uintmax_t, std::filesystem::path>> bySize;
+    for (auto& file : files)
+    {
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(file, error);
+        bySize.emplace_back(error ? 0 : size, std::move(file));
+    }
+    std::stable_sort(bySize.begin(), bySize.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (auto& entry : bySize)
+    {
+        pool.submit([path = std::move(entry.second), &makeSequencer, &results, budget, &options]
+        {
+            results.add(solveInstance(path.string(), [&] { return Instance{ path, options }; }, makeSequencer, budget));
+        });
+    }
+
+    pool.wait();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Sequencer.h"
+#include "ThreadPool.h"
+
+struct BatchResult
+{
+    std::string name;
+    size_t used = 0; // oligonucleotides in the solution
+    size_t bestSolutionSize = 0;
+    double milliseconds = 0.0; // solving time, without loading
+    std::string sequence; // reconstructed from the solution
+    std::string error; // empty when the instance was solved
+    std::string metrics; // SolverMetrics::toJson of the run
+};
+
+// Collects results from every thread of a batch.
+class ResultCollector
+{
+public:
+    void add(BatchResult result);
+
+    // every result so far, sorted by name
+    std::vector<BatchResult> results() const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<BatchResult> collected;
+};
+
+// a new sequencer for every instance, called from the pool's threads
+using SequencerFactory = std::function<std::unique_ptr<Sequencer>()>;
+
+// Loads an instance with `load` and solves it with a new sequencer, budget > 0 gives it
+// that much wall-clock time. Errors end up in BatchResult::error.
+BatchResult solveInstance(const std::string& name, const std::function<Instance()>& load,
+    const SequencerFactory& makeSequencer, std::chrono::milliseconds budget = std::chrono::milliseconds{ 0 });
+// the same with a sequencer kept between instances
+BatchResult solveInstance(const std::string& name, const std::function<Instance()>& load, Sequencer& sequencer,
+    std::chrono::milliseconds budget = std::chrono::milliseconds{ 0 });
+
+// Loads and solves every file as one task on `pool`, the largest files first so the
+// longest tasks do not end up last. budget > 0 gives every instance that much
+// wall-clock time. Returns when all of them are in `results`.
+void runBatch(std::vector<std::filesystem::path> files, const SequencerFactory& makeSequencer, ThreadPool& pool,
+    ResultCollector& results, std::chrono::milliseconds budget = std::chrono::milliseconds{ 0 },
+    const InstanceOptions& options = {});
@@ -0,0 +1,257 @@
+#include "BeamSearch.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "Random.h"
+
+namespace
+{
+    template <typename Candidate>
+    bool ranksBefore(const Candidate& a, const Candidate& b)
+    {
+        if (a.waste() != b.waste())
+            return a.waste() < b.waste();
+        if (a.count != b.count)
+            return a.count > b.count;
+        if (a.path != b.path)
+            return a.path < b.path;
+        return a.vertex < b.vertex;
+    }
+}
+
+void BeamSearch::Beam::reserve(size_t width, size_t words)
+{
+    nodes.reserve(width);
+    lengths.reserve(width);
+    counts.reserve(width);
+    hashes.reserve(width);
+    visited.reserve(width * words);
+}
+
+void BeamSearch::Beam::clear()
+{
+    nodes.clear();
+    lengths.clear();
+    counts.clear();
+    hashes.clear();
+    visited.clear();
+}
+
+BeamSearch::BeamSearch(const Instance& instance, size_t width, size_t branching)
+    : instance{ &instance }, width{ std::max<size_t>(width, 1) }, branching{ std::max<size_t>(branching, 1) },
+      size{ instance.oligonucleotides.size() }, words{ (instance.oligonucleotides.size() + 63) / 64 }
+{
+    CounterRng random{ 0x5DEECE66Dull };
+    vertexKeys.resize(size);
+    for (uint64_t& key : vertexKeys)
+        key = random.nextUInt64();
+
+    // Weights into compacted chains include the chain and can reach l, where candidate
+    // lists stop, so those keep scanning whole rows.
+    candidateLists = &instance.candidates;
+    if (instance.candidates.empty() && instance.chainStarts.empty())
+    {
+        if (!instance.overlaps.empty())
+            ownCandidates.build(instance.overlaps, CANDIDATES);
+        else
+            ownCandidates.build(instance.adjMatrix, instance.l, CANDIDATES);
+        candidateLists = &ownCandidates;
+    }
+    if (!instance.hasAdjMatrix())
+        sparseRow.assign(size, static_cast<OverlapMatrix::Weight>(instance.l));
+
+    // a path is at most one vertex per depth
+    history.reserve(this->width * (size + 1));
+    candidates.reserve(this->width * this->branching);
+    best.reserve(this->branching + 1);
+}
+
+std::vector<size_t> BeamSearch::run(const StopCondition& stop)
+{
+    history.clear();
+    Beam current;
+    Beam next;
+    current.reserve(width, words);
+    next.reserve(width, words);
+    start(current);
+
+    uint32_t bestNode = ROOT;
+    size_t bestCount = 0;
+    size_t bestLength = 0;
+    while (!current.nodes.empty())
+    {
+        for (size_t path = 0; path < current.nodes.size(); ++path)
+        {
+            if (current.counts[path] > bestCount
+                || (current.counts[path] == bestCount && current.lengths[path] < bestLength))
+            {
+                bestNode = current.nodes[path];
+                bestCount = current.counts[path];
+                bestLength = current.lengths[path];
+            }
+        }
+        if ((instance->bestSolutionSize > 0 && bestCount >= instance->bestSolutionSize) || stop.stopRequested())
+            break;
+
+        candidates.clear();
+        for (size_t path = 0; path < current.nodes.size(); ++path)
+            extend(current, path);
+        if (candidates.empty())
+            break;
+
+        // paths with the same vertices ending in the same one only differ in length, keep the shorter
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            if (a.hash != b.hash)
+                return a.hash < b.hash;
+            if (a.vertex != b.vertex)
+                return a.vertex < b.vertex;
+            return ranksBefore(a, b);
+        });
+        candidates.erase(std::unique(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return a.hash == b.hash && a.vertex == b.vertex;
+        }), candidates.end());
+
+        if (candidates.size() > width)
+        {
+            std::nth_element(candidates.begin(), candidates.begin() + width, candidates.end(),
+                ranksBefore<Candidate>);
+            candidates.resize(width);
+        }
+
+        next.clear();
+        for (const Candidate& candidate : candidates)
+        {
+            history.push_back(Node{ candidate.vertex, current.nodes[candidate.path] });
+            next.nodes.push_back(static_cast<uint32_t>(history.size() - 1));
+            next.lengths.push_back(candidate.length);
+            next.counts.push_back(candidate.count);
+            next.hashes.push_back(candidate.hash);
+
+            const auto row = current.visited.begin() + candidate.path * words;
+            next.visited.insert(next.visited.end(), row, row + words);
+            next.visited[(next.nodes.size() - 1) * words + candidate.vertex / 64] |= uint64_t{ 1 } << (candidate.vertex % 64);
+        }
+        std::swap(current, next);
+    }
+
+    std::vector<size_t> path;
+    for (uint32_t node = bestNode; node != ROOT; node = history[node].parent)
+        path.push_back(history[node].vertex);
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+void BeamSearch::start(Beam& beam)
+{
+    // A vertex no other one overlaps well is where a sequence is likely to begin. The
+    // weight of an edge into a compacted chain includes the chain, leave that out.
+    std::vector<size_t> bestIncoming(size, std::numeric_limits<size_t>::max());
+    if (instance->hasAdjMatrix())
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            const OverlapMatrix::Weight* row = instance->adjMatrix.row(i);
+            for (size_t j = 0; j < size; ++j)
+            {
+                if (i != j)
+                    bestIncoming[j] = std::min<size_t>(bestIncoming[j], row[j] - (instance->chainLength(j) - 1));
+            }
+        }
+    }
+    else
+    {
+        // only the listed overlaps beat weight l
+        const SparseOverlaps& overlaps = instance->overlaps;
+        std::fill(bestIncoming.begin(), bestIncoming.end(), instance->l);
+        for (size_t i = 0; i < size; ++i)
+        {
+            for (size_t e = 0; e < overlaps.count(i); ++e)
+            {
+                const uint32_t j = overlaps.vertices(i)[e];
+                bestIncoming[j] = std::min<size_t>(bestIncoming[j], overlaps.weights(i)[e]);
+            }
+        }
+    }
+
+    std::vector<uint32_t> starts;
+    for (size_t v = 0; v < size; ++v)
+    {
+        if (instance->startLength(v) <= instance->n)
+            starts.push_back(static_cast<uint32_t>(v));
+    }
+    auto later = [&](uint32_t a, uint32_t b) {
+        return bestIncoming[a] != bestIncoming[b] ? bestIncoming[a] > bestIncoming[b] : a < b;
+    };
+    if (starts.size() > width)
+    {
+        std::partial_sort(starts.begin(), starts.begin() + width, starts.end(), later);
+        starts.resize(width);
+    }
+
+    for (uint32_t v : starts)
+    {
+        history.push_back(Node{ v, ROOT });
+        beam.nodes.push_back(static_cast<uint32_t>(history.size() - 1));
+        beam.lengths.push_back(instance->startLength(v));
+        beam.counts.push_back(instance->chainLength(v));
+        beam.hashes.push_back(vertexKeys[v]);
+        beam.visited.resize(beam.visited.size() + words, 0);
+        beam.visited[(beam.nodes.size() - 1) * words + v / 64] |= uint64_t{ 1 } << (v % 64);
+    }
+}
+
+void BeamSearch::extend(const Beam& beam, size_t path)
+{
+    const uint32_t last = history[beam.nodes[path]].vertex;
+    best.clear();
+    auto consider = [&](size_t v, size_t weight) {
+        if (visited(beam, path, v) || beam.lengths[path] + weight > instance->n)
+            return;
+
+        Candidate candidate{ static_cast<uint32_t>(path), static_cast<uint32_t>(v), beam.lengths[path] + weight,
+            beam.counts[path] + instance->chainLength(v), beam.hashes[path] ^ vertexKeys[v] };
+        if (best.size() == branching && !ranksBefore(candidate, best.back()))
+            return;
+        best.insert(std::upper_bound(best.begin(), best.end(), candidate, ranksBefore<Candidate>), candidate);
+        if (best.size() > branching)
+            best.pop_back();
+    };
+
+    // the candidate list is enough unless too many of its vertices are taken
+    const CandidateLists& lists = *candidateLists;
+    if (!lists.empty())
+    {
+        const uint32_t* vertices = lists.vertices(last);
+        const CandidateLists::Weight* weights = lists.weights(last);
+        for (size_t k = 0; k < lists.count(last); ++k)
+            consider(vertices[k], weights[k]);
+    }
+    if (best.size() < branching)
+    {
+        best.clear();
+        if (instance->hasAdjMatrix())
+        {
+            const OverlapMatrix::Weight* row = instance->adjMatrix.row(last);
+            for (size_t v = 0; v < size; ++v)
+                consider(v, row[v]);
+        }
+        else
+        {
+            // the whole row from the sparse one, put back to weight l afterwards
+            const SparseOverlaps& overlaps = instance->overlaps;
+            const uint32_t* vertices = overlaps.vertices(last);
+            const OverlapMatrix::Weight* weights = overlaps.weights(last);
+            for (size_t e = 0; e < overlaps.count(last); ++e)
+                sparseRow[vertices[e]] = weights[e];
+            sparseRow[last] = OverlapMatrix::NO_EDGE;
+            for (size_t v = 0; v < size; ++v)
+                consider(v, sparseRow[v]);
+            for (size_t e = 0; e < overlaps.count(last); ++e)
+                sparseRow[vertices[e]] = static_cast<OverlapMatrix::Weight>(instance->l);
+            sparseRow[last] = static_cast<OverlapMatrix::Weight>(instance->l);
+        }
+    }
+
+    candidates.insert(candidates.end(), best.begin(), best.end());
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Instance.h"
+#include "StopCondition.h"
+
+// Breadth-first construction keeping the `width` best partial paths at every depth.
+// Every path is extended with its `branching` best-overlapping unvisited successors
+// that still fit in Instance::n, and paths are ranked by the characters they spend
+// beyond one per oligonucleotide. Successors come from candidate lists, built here
+// when the instance has none, and beams, visited bitsets and the path history are
+// allocated once per search, so a 500-oligonucleotide spectrum takes milliseconds.
+// Without Instance::adjMatrix the weights come from Instance::overlaps.
+class BeamSearch
+{
+public:
+    static constexpr size_t DEFAULT_WIDTH = 64;
+    static constexpr size_t DEFAULT_BRANCHING = 4;
+
+    BeamSearch(const Instance& instance, size_t width = DEFAULT_WIDTH, size_t branching = DEFAULT_BRANCHING);
+
+    // the path with the most oligonucleotides seen, `stop` ends the search after the current depth
+    std::vector<size_t> run(const StopCondition& stop = StopCondition{});
+
+private:
+    // one extension of a path, the previous one is `parent` in history
+    struct Node
+    {
+        uint32_t vertex;
+        uint32_t parent;
+    };
+
+    // a path of the beam, its visited vertices are one row of Beam::visited
+    struct Beam
+    {
+        std::vector<uint32_t> nodes; // index into history of every path's last vertex
+        std::vector<size_t> lengths; // characters
+        std::vector<size_t> counts; // oligonucleotides
+        std::vector<uint64_t> hashes; // of the visited set
+        std::vector<uint64_t> visited; // width x words
+
+        void reserve(size_t width, size_t words);
+        void clear();
+    };
+
+    struct Candidate
+    {
+        uint32_t path; // in the current beam
+        uint32_t vertex;
+        size_t length;
+        size_t count;
+        uint64_t hash;
+
+        size_t waste() const { return length - count; }
+    };
+
+    static constexpr uint32_t ROOT = UINT32_MAX;
+    static constexpr size_t CANDIDATES = 16; // successors kept per vertex when building candidate lists
+
+    void start(Beam& beam);
+    void extend(const Beam& beam, size_t path);
+    bool visited(const Beam& beam, size_t path, size_t vertex) const
+    {
+        return beam.visited[path * words + vertex / 64] >> (vertex % 64) & 1;
+    }
+
+    const Instance* instance;
+    const size_t width;
+    const size_t branching;
+    const size_t size;
+    const size_t words; // of a visited bitset
+
+    CandidateLists ownCandidates; // when the instance has none
+    const CandidateLists* candidateLists;
+    std::vector<uint64_t> vertexKeys; // random key of every vertex, a visited set hashes to their xor
+    std::vector<Node> history; // every path kept, in the order of the depths
+    std::vector<Candidate> candidates; // width x branching extensions of one depth
+    std::vector<Candidate> best; // scratch: the best extensions of one path
+    std::vector<OverlapMatrix::Weight> sparseRow; // scratch: a row of Instance::overlaps, without adjMatrix
+};
@@ -0,0 +1,103 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// FIFO queue of at most `capacity` items shared by producer and consumer threads.
+// Once closed, producers are turned away and consumers drain what is left.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity) : capacity{ capacity > 0 ? capacity : 1 } {}
+
+    // waits while the queue is full, returns false if it is closed
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock{ mutex };
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed)
+            return false;
+
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // returns false right away if the queue is full or closed
+    bool tryPush(T item)
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        if (closed || items.size() >= capacity)
+            return false;
+
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Never waits: drops the oldest items to make room, so a queue of capacity 1 is a
+    // slot where the latest item wins. Returns false if the queue is closed.
+    bool pushLatest(T item)
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        if (closed)
+            return false;
+
+        while (items.size() >= capacity)
+            items.pop_front();
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // waits for an item, nothing once the queue is closed and empty
+    std::optional<T> pop()
+    {
+        std::unique_lock<std::mutex> lock{ mutex };
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        return take();
+    }
+
+    // nothing if the queue is empty
+    std::optional<T> tryPop()
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        return take();
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        return items.size();
+    }
+
+private:
+    std::optional<T> take()
+    {
+        if (items.empty())
+            return std::nullopt;
+
+        std::optional<T> item{ std::move(items.front()) };
+        items.pop_front();
+        notFull.notify_one();
+        return item;
+    }
+
+    const size_t capacity;
+    mutable std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<T> items;
+    bool closed = false;
+};
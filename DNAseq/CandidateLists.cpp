@@ -0,0 +1,139 @@
+#include "CandidateLists.h"
+
+#include <algorithm>
+
+void CandidateLists::build(const OverlapMatrix& adjMatrix, size_t l, size_t k)
+{
+    const size_t size = adjMatrix.size();
+    this->k = k;
+    counts.assign(size, 0);
+    targets.assign(size * k, 0);
+    targetWeights.assign(size * k, 0);
+
+    for (size_t i = 0; i < size; ++i)
+        buildRow(adjMatrix, l, i);
+}
+
+void CandidateLists::build(const SparseOverlaps& overlaps, size_t k)
+{
+    const size_t size = overlaps.size();
+    this->k = k;
+    counts.assign(size, 0);
+    targets.assign(size * k, 0);
+    targetWeights.assign(size * k, 0);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        const size_t taken = std::min(overlaps.count(i), k);
+        std::copy(overlaps.vertices(i), overlaps.vertices(i) + taken, targets.data() + i * k);
+        std::copy(overlaps.weights(i), overlaps.weights(i) + taken, targetWeights.data() + i * k);
+        counts[i] = static_cast<uint32_t>(taken);
+    }
+}
+
+void CandidateLists::buildRow(const OverlapMatrix& adjMatrix, size_t l, size_t i)
+{
+    // One pass of partial selection: a weight that does not beat the worst of a full
+    // row is turned away with a single comparison, so a row costs O(s) and only the
+    // rare better weights pay for the insertion.
+    const size_t size = adjMatrix.size();
+    const Weight* row = adjMatrix.row(i);
+    counts[i] = 0;
+    for (size_t j = 0; j < size; ++j)
+    {
+        if (row[j] < l)
+            offer(i, static_cast<uint32_t>(j), row[j], l);
+    }
+}
+
+void CandidateLists::offer(size_t i, uint32_t j, Weight weight, size_t l)
+{
+    if (weight >= l || k == 0)
+        return;
+
+    uint32_t* rowTargets = targets.data() + i * k;
+    Weight* rowWeights = targetWeights.data() + i * k;
+    size_t position = counts[i];
+    while (position > 0 && (rowWeights[position - 1] > weight
+        || (rowWeights[position - 1] == weight && rowTargets[position - 1] > j)))
+        --position;
+    if (position == k)
+        return;
+
+    const size_t last = std::min<size_t>(counts[i], k - 1);
+    std::copy_backward(rowTargets + position, rowTargets + last, rowTargets + last + 1);
+    std::copy_backward(rowWeights + position, rowWeights + last, rowWeights + last + 1);
+    rowTargets[position] = j;
+    rowWeights[position] = weight;
+    counts[i] = static_cast<uint32_t>(std::min<size_t>(counts[i] + 1, k));
+}
+
+void CandidateLists::addVertex(const OverlapMatrix& adjMatrix, size_t l)
+{
+    const size_t v = counts.size();
+    counts.push_back(0);
+    targets.resize(counts.size() * k);
+    targetWeights.resize(counts.size() * k);
+    buildRow(adjMatrix, l, v);
+
+    for (size_t i = 0; i < v; ++i)
+        offer(i, static_cast<uint32_t>(v), adjMatrix(i, v), l);
+}
+
+void CandidateLists::removeVertex(const OverlapMatrix& adjMatrix, size_t l, size_t v)
+{
+    const size_t last = counts.size() - 1;
+    if (v != last)
+    {
+        std::copy(targets.begin() + last * k, targets.begin() + (last + 1) * k, targets.begin() + v * k);
+        std::copy(targetWeights.begin() + last * k, targetWeights.begin() + (last + 1) * k, targetWeights.begin() + v * k);
+        counts[v] = counts[last];
+    }
+    counts.pop_back();
+    targets.resize(counts.size() * k);
+    targetWeights.resize(counts.size() * k);
+
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        uint32_t* rowTargets = targets.data() + i * k;
+        uint32_t* end = rowTargets + counts[i];
+        if (std::find(rowTargets, end, static_cast<uint32_t>(v)) != end)
+        {
+            // a slot opened, the next best successor is only in adjMatrix
+            buildRow(adjMatrix, l, i);
+            continue;
+        }
+
+        if (v == last)
+            continue;
+
+        // with its lower index the moved vertex may now win a tie it lost before
+        uint32_t* renamed = std::find(rowTargets, end, static_cast<uint32_t>(last));
+        if (renamed == end)
+        {
+            offer(i, static_cast<uint32_t>(v), adjMatrix(i, v), l);
+            continue;
+        }
+
+        // keep the order by index among equal weights
+        Weight* rowWeights = targetWeights.data() + i * k;
+        size_t position = renamed - rowTargets;
+        const Weight weight = rowWeights[position];
+        *renamed = static_cast<uint32_t>(v);
+        while (position > 0 && rowWeights[position - 1] == weight && rowTargets[position - 1] > v)
+        {
+            std::swap(rowTargets[position - 1], rowTargets[position]);
+            --position;
+        }
+    }
+}
+
+bool CandidateLists::contains(size_t i, size_t j) const
+{
+    if (empty())
+        return false;
+
+    const uint32_t* begin = vertices(i);
+    const uint32_t* end = begin + count(i);
+    return std::find(begin, end, static_cast<uint32_t>(j)) != end;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "OverlapMatrix.h"
+#include "SparseOverlaps.h"
+
+// The k best successors of every oligonucleotide, in k slots per row. Row i lists
+// only real overlaps (weight < l), best overlap (smallest weight) first and by index
+// among equal weights, so memory is O(s * k) and a row is a short scan. The fixed
+// slots let a row change in place when vertices are added or removed.
+class CandidateLists
+{
+public:
+    using Weight = OverlapMatrix::Weight;
+
+    void build(const OverlapMatrix& adjMatrix, size_t l, size_t k);
+    // the first k of every row, which are already ranked, in O(s * k)
+    void build(const SparseOverlaps& overlaps, size_t k);
+
+    // After a vertex was appended to adjMatrix: its own row, and the rows it now ranks
+    // in. O(s) plus O(k) per row that takes it.
+    void addVertex(const OverlapMatrix& adjMatrix, size_t l);
+    // After vertex v was removed from adjMatrix by moving the last vertex into its
+    // place: rows that listed v are rebuilt from adjMatrix, the others get the moved
+    // vertex renamed or offered under its new index. O(s * k) plus O(s) per rebuilt row.
+    void removeVertex(const OverlapMatrix& adjMatrix, size_t l, size_t v);
+
+    bool empty() const { return counts.empty(); }
+    size_t size() const { return counts.size(); }
+    size_t maxCandidates() const { return k; }
+
+    size_t count(size_t i) const { return empty() ? 0 : counts[i]; }
+    const uint32_t* vertices(size_t i) const { return targets.data() + i * k; }
+    const Weight* weights(size_t i) const { return targetWeights.data() + i * k; }
+
+    bool contains(size_t i, size_t j) const;
+
+private:
+    void buildRow(const OverlapMatrix& adjMatrix, size_t l, size_t i);
+    // puts j into row i if it ranks among the k best
+    void offer(size_t i, uint32_t j, Weight weight, size_t l);
+
+    size_t k = 0;
+    std::vector<uint32_t> counts; // used slots of every row
+    std::vector<uint32_t> targets; // row i in [i * k, i * k + counts[i])
+    std::vector<Weight> targetWeights;
+};
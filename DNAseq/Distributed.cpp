@@ -0,0 +1,359 @@
+#include "Distributed.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "Logger.h"
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+extern char** environ;
+#endif
+
+namespace
+{
+    struct Task
+    {
+        std::filesystem::path path;
+        size_t attempts = 0; // workers lost while solving it
+    };
+
+    // Files not yet solved. A task taken by a worker stays in flight until it is
+    // done or put back, so idle workers keep waiting while another may still fail.
+    class TaskQueue
+    {
+    public:
+        explicit TaskQueue(std::deque<Task> tasks) : pending{ std::move(tasks) } {}
+
+        // the next task, or nothing once every task is done
+        std::optional<Task> take()
+        {
+            std::unique_lock<std::mutex> lock{ mutex };
+            changed.wait(lock, [this] { return !pending.empty() || inFlight == 0; });
+            if (pending.empty())
+                return std::nullopt;
+
+            Task task = std::move(pending.front());
+            pending.pop_front();
+            ++inFlight;
+            return task;
+        }
+
+        void requeue(Task task)
+        {
+            std::lock_guard<std::mutex> lock{ mutex };
+            pending.push_front(std::move(task));
+            --inFlight;
+            changed.notify_all();
+        }
+
+        void done()
+        {
+            std::lock_guard<std::mutex> lock{ mutex };
+            --inFlight;
+            changed.notify_all();
+        }
+
+        bool finished()
+        {
+            std::lock_guard<std::mutex> lock{ mutex };
+            return pending.empty() && inFlight == 0;
+        }
+
+        // the tasks no worker took, they are no longer pending
+        std::deque<Task> takePending()
+        {
+            std::lock_guard<std::mutex> lock{ mutex };
+            std::deque<Task> tasks = std::move(pending);
+            pending.clear();
+            changed.notify_all();
+            return tasks;
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<Task> pending;
+        size_t inFlight = 0;
+    };
+
+    std::string singleLine(std::string text)
+    {
+        std::replace(text.begin(), text.end(), '\n', ' ');
+        return text;
+    }
+
+    // one worker connection, until the queue is empty or the worker is lost
+    void serveWorker(Socket connection, TaskQueue& queue, ResultCollector& results, std::chrono::milliseconds budget,
+        size_t maxAttempts)
+    {
+        // a worker that hangs is lost like one that disconnects
+        const std::chrono::milliseconds replyTimeout = budget.count() > 0 ? budget + REPLY_GRACE
+            : std::chrono::milliseconds{ UNBUDGETED_REPLY_TIMEOUT };
+        connection.setReceiveTimeout(static_cast<int>(replyTimeout.count()));
+
+        while (std::optional<Task> task = queue.take())
+        {
+            const std::string name = task->path.filename().string();
+            BatchResult result;
+            result.name = name;
+
+            std::string spectrum;
+            try
+            {
+                spectrum = std::string{ MappedFile{ task->path }.view() };
+            }
+            catch (const std::exception& e)
+            {
+                result.error = e.what();
+                results.add(std::move(result));
+                queue.done();
+                continue;
+            }
+
+            try
+            {
+                std::ostringstream request;
+                request << "SOLVE " << budget.count() << ' ' << spectrum.size() << ' ' << name << '\n';
+                connection.send(request.str());
+                connection.send(spectrum);
+
+                std::istringstream reply{ connection.readLine() };
+                std::string kind;
+                reply >> kind;
+                if (kind == "RESULT")
+                {
+                    reply >> result.used >> result.bestSolutionSize >> result.milliseconds;
+                    std::getline(reply >> std::ws, result.name);
+                    result.sequence = connection.readLine();
+                    result.metrics = connection.readLine();
+                }
+                else if (kind == "ERROR")
+                {
+                    std::getline(reply >> std::ws, result.name);
+                    result.error = connection.readLine();
+                }
+                else
+                {
+                    throw std::runtime_error{ "unexpected reply " + kind };
+                }
+            }
+            catch (const std::exception& e)
+            {
+                LOG_WARN("worker lost while solving {}: {}", name, e.what());
+                if (++task->attempts >= maxAttempts)
+                {
+                    result.error = "lost " + std::to_string(task->attempts) + " workers";
+                    results.add(std::move(result));
+                    queue.done();
+                }
+                else
+                {
+                    queue.requeue(std::move(*task));
+                }
+                return;
+            }
+
+            results.add(std::move(result));
+            queue.done();
+        }
+
+        try
+        {
+            connection.send("QUIT\n");
+        }
+        catch (const std::exception&)
+        {
+        }
+    }
+}
+
+std::string encodeReply(const BatchResult& result)
+{
+    std::ostringstream reply;
+    if (result.error.empty())
+    {
+        reply << "RESULT " << result.used << ' ' << result.bestSolutionSize << ' ' << result.milliseconds
+              << ' ' << result.name << '\n' << result.sequence << '\n' << result.metrics << '\n';
+    }
+    else
+    {
+        reply << "ERROR " << result.name << '\n' << singleLine(result.error) << '\n';
+    }
+    return reply.str();
+}
+
+void runCoordinator(std::vector<std::filesystem::path> files, Socket& listener, ResultCollector& results,
+    std::chrono::milliseconds budget, size_t maxAttempts, const std::function<bool()>& workersMayConnect)
+{
+    // largest first, as in runBatch
+    std::vector<std::pair<uintmax_t, std::filesystem::path>> bySize;
+    for (auto& file : files)
+    {
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(file, error);
+        bySize.emplace_back(error ? 0 : size, std::move(file));
+    }
+    std::stable_sort(bySize.begin(), bySize.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    std::deque<Task> tasks;
+    for (auto& entry : bySize)
+        tasks.push_back(Task{ std::move(entry.second) });
+    TaskQueue queue{ std::move(tasks) };
+
+    std::vector<std::thread> workers;
+    std::atomic<size_t> connected{ 0 }; // counted down once a worker's task is done or put back
+    while (!queue.finished())
+    {
+        Socket connection = listener.accept(100);
+        if (!connection)
+        {
+            if (connected == 0 && workersMayConnect && !workersMayConnect())
+            {
+                for (Task& task : queue.takePending())
+                {
+                    BatchResult result;
+                    result.name = task.path.filename().string();
+                    result.error = "no worker left";
+                    results.add(std::move(result));
+                }
+                LOG_ERROR("every worker is gone, the files left failed");
+                break;
+            }
+            continue;
+        }
+
+        LOG_INFO("worker {} connected", workers.size() + 1);
+        ++connected;
+        workers.emplace_back([&, connection = std::move(connection)]() mutable {
+            serveWorker(std::move(connection), queue, results, budget, maxAttempts);
+            --connected;
+        });
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void runWorker(const std::string& address, const SequencerFactory& makeSequencer, const InstanceOptions& options,
+    std::chrono::milliseconds connectTimeout)
+{
+    // the coordinator may not be listening yet
+    const auto deadline = std::chrono::steady_clock::now() + connectTimeout;
+    Socket connection;
+    while (!connection)
+    {
+        try
+        {
+            connection = Socket::connect(address);
+        }
+        catch (const std::exception&)
+        {
+            if (std::chrono::steady_clock::now() >= deadline)
+                throw;
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+        }
+    }
+
+    try
+    {
+        while (true)
+        {
+            std::istringstream request{ connection.readLine() };
+            std::string kind;
+            request >> kind;
+            if (kind == "QUIT")
+                return;
+            if (kind != "SOLVE")
+                throw std::runtime_error{ "unexpected request " + kind };
+
+            long long budget = 0;
+            size_t size = 0;
+            std::string name;
+            request >> budget >> size;
+            std::getline(request >> std::ws, name);
+            if (size > MAX_SPECTRUM_BYTES)
+                throw std::runtime_error{ "spectrum of " + std::to_string(size) + " bytes" };
+            const std::string spectrum = connection.read(size);
+
+            BatchResult result = solveInstance(name, [&] { return Instance{ name, spectrum, options }; }, makeSequencer,
+                std::chrono::milliseconds{ budget });
+
+            connection.send(encodeReply(result));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // the coordinator is gone, nothing is left to report to
+        LOG_WARN("coordinator lost: {}", e.what());
+    }
+}
+
+intptr_t spawnProcess(const std::string& executable, const std::vector<std::string>& arguments)
+{
+#ifdef _WIN32
+    std::string commandLine = '"' + executable + '"';
+    for (const std::string& argument : arguments)
+        commandLine += " \"" + argument + '"';
+
+    STARTUPINFOA startup{};
+    startup.cb = sizeof(startup);
+    PROCESS_INFORMATION process{};
+    if (!CreateProcessA(executable.c_str(), commandLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr,
+        &startup, &process))
+        throw std::runtime_error{ "cannot start " + executable };
+    CloseHandle(process.hThread);
+    return reinterpret_cast<intptr_t>(process.hProcess);
+#else
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(executable.c_str()));
+    for (const std::string& argument : arguments)
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    argv.push_back(nullptr);
+
+    pid_t process;
+    if (posix_spawnp(&process, executable.c_str(), nullptr, nullptr, argv.data(), environ) != 0)
+        throw std::runtime_error{ "cannot start " + executable };
+    return process;
+#endif
+}
+
+void waitForProcess(intptr_t process)
+{
+#ifdef _WIN32
+    HANDLE handle = reinterpret_cast<HANDLE>(process);
+    WaitForSingleObject(handle, INFINITE);
+    CloseHandle(handle);
+#else
+    int status;
+    waitpid(static_cast<pid_t>(process), &status, 0);
+#endif
+}
+
+bool processExited(intptr_t process)
+{
+#ifdef _WIN32
+    HANDLE handle = reinterpret_cast<HANDLE>(process);
+    if (WaitForSingleObject(handle, 0) != WAIT_OBJECT_0)
+        return false;
+    CloseHandle(handle);
+    return true;
+#else
+    int status;
+    return waitpid(static_cast<pid_t>(process), &status, WNOHANG) != 0;
+#endif
+}
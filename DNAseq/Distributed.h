@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Batch.h"
+#include "Socket.h"
+
+// A batch spread over worker processes, on this host or others, that connect to a
+// coordinator. The protocol is line based, one spectrum at a time per worker:
+//
+//   coordinator: SOLVE <budget ms> <bytes> <name>\n<spectrum>
+//   worker:      RESULT <used> <best solution size> <solving ms> <name>\n<sequence>\n<metrics json>\n
+//                ERROR <name>\n<message>\n
+//   coordinator: QUIT\n once nothing is left
+//
+// A spectrum whose worker disconnects, or does not answer within its budget and
+// REPLY_GRACE (UNBUDGETED_REPLY_TIMEOUT without a budget), is sent to another worker.
+
+// the largest spectrum a worker accepts, the <bytes> of SOLVE come from the peer
+constexpr size_t MAX_SPECTRUM_BYTES = size_t{ 64 } << 20;
+
+// how much longer than the budget a worker may take to load a spectrum and reply
+constexpr std::chrono::seconds REPLY_GRACE{ 60 };
+
+// how long a worker may take to reply when there is no budget, the colony stops by
+// itself long before this on any instance it can solve
+constexpr std::chrono::minutes UNBUDGETED_REPLY_TIMEOUT{ 30 };
+
+// the RESULT or ERROR reply for `result`
+std::string encodeReply(const BatchResult& result);
+
+// Sends every file to the workers connecting to `listener` until all of them are in
+// `results`. A file is given up on after maxAttempts workers were lost on it. Keeps
+// waiting for workers as long as files are left, unless workersMayConnect is given:
+// once no worker is connected and it returns false, the files left fail.
+void runCoordinator(std::vector<std::filesystem::path> files, Socket& listener, ResultCollector& results,
+    std::chrono::milliseconds budget = std::chrono::milliseconds{ 0 }, size_t maxAttempts = 3,
+    const std::function<bool()>& workersMayConnect = {});
+
+// Connects to the coordinator at `address`, retrying for up to connectTimeout, and
+// solves what it sends until it says QUIT or disconnects.
+void runWorker(const std::string& address, const SequencerFactory& makeSequencer, const InstanceOptions& options = {},
+    std::chrono::milliseconds connectTimeout = std::chrono::seconds{ 10 });
+
+// Starts `executable arguments...` in the background and returns its process id.
+// Throws std::runtime_error when it cannot be started.
+intptr_t spawnProcess(const std::string& executable, const std::vector<std::string>& arguments);
+// waits until a process started by spawnProcess exits
+void waitForProcess(intptr_t process);
+// whether a process started by spawnProcess exited, without waiting; one that did is
+// released and must not be waited for
+bool processExited(intptr_t process);
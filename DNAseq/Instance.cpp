@@ -1,30 +1,181 @@
 #include "Instance.h"
 
-Instance::Instance(std::filesystem::path filepath)
-    : filepath{ filepath }
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
 {
-    std::ifstream file{ filepath };
-    if (file.is_open())
+    // part of the temporary cache file names
+    long processId()
+    {
+#ifdef _WIN32
+        return _getpid();
+#else
+        return getpid();
+#endif
+    }
+
+    // Cache file layout, in native byte order: CacheHeader, count + 1 offsets of the
+    // oligonucleotides in the following bytes, the oligonucleotide bytes, then the
+    // adjacency matrix as count rows of count weights.
+    constexpr char CACHE_MAGIC[8] = { 'D', 'N', 'A', 's', 'e', 'q', 'O', 'V' };
+    constexpr uint32_t CACHE_VERSION = 1;
+
+    struct CacheHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t headerSize;
+        uint64_t key;
+        uint64_t n;
+        uint64_t s;
+        uint64_t l;
+        uint64_t numErrors;
+        uint64_t bestSolutionSize;
+        uint32_t errorType;
+        uint32_t weightSize;
+        uint64_t count;
+        uint64_t oligonucleotideBytes;
+    };
+    static_assert(sizeof(CacheHeader) == 88, "CacheHeader must not have padding");
+
+    uint64_t fnv1a(std::string_view bytes, uint64_t hash = 0xCBF29CE484222325ull)
     {
-        while (file)
+        for (unsigned char c : bytes)
         {
-            std::string oligonucleotide;
-            std::getline(file, oligonucleotide);
-            if (!oligonucleotide.empty())
-                oligonucleotides.push_back(std::move(oligonucleotide));
+            hash ^= c;
+            hash *= 0x100000001B3ull;
         }
-        file.close();
+        return hash;
     }
-    extractInstanceInfo();
 
-    buildAdjMatrix();
-    // buildAdjList();
+    // everything the cached data depends on
+    uint64_t cacheKey(std::string_view spectrum, const std::string& name, const InstanceOptions& options)
+    {
+        std::ostringstream build;
+        build << name << '|' << options.buildMode << '|' << options.minOverlap;
+        return fnv1a(build.str(), fnv1a(spectrum));
+    }
 }
 
-void Instance::extractInstanceInfo()
+Instance::Instance(std::filesystem::path filepath, const InstanceOptions& options)
+    : filepath{ filepath }
 {
+    MappedFile file{ filepath };
     name = filepath.filename().string();
+    build(file.view(), options);
+}
+
+Instance::Instance(std::string name, std::string_view spectrum, const InstanceOptions& options)
+    : name{ std::move(name) }
+{
+    // there is no file to cache next to
+    InstanceOptions cacheOptions = options;
+    cacheOptions.useCache = options.useCache && !options.cacheDirectory.empty();
+    build(spectrum, cacheOptions);
+}
+
+void Instance::build(std::string_view spectrum, const InstanceOptions& options)
+{
+    // the cache holds the dense matrix
+    const bool useCache = options.useCache && (options.buildMode == InstanceOptions::PAIRWISE || options.denseMatrix);
+    uint64_t key = 0;
+    std::filesystem::path cache;
+    bool cached = false;
+    if (useCache)
+    {
+        key = cacheKey(spectrum, name, options);
+        cache = cachePath(options, key);
+        cached = loadCache(cache, key);
+    }
+
+    if (!cached)
+    {
+        readOligonucleotides(spectrum);
+        extractInstanceInfo();
+    }
+    packOligonucleotides();
+
+    if (!cached)
+    {
+        if (options.buildMode == InstanceOptions::PAIRWISE)
+            buildAdjMatrix();
+        else if (options.denseMatrix)
+            buildAdjMatrixIndexed(options.minOverlap);
+        else
+            buildOverlapsIndexed(options.minOverlap);
+
+        if (useCache)
+            writeCache(cache, key);
+    }
+
+    if (options.candidateListSize > 0)
+        buildCandidateLists(options.candidateListSize);
+}
+
+void Instance::readOligonucleotides(std::string_view text)
+{
+    // one line per oligonucleotide; the buffer is sized by a first pass so it never
+    // reallocates under the views
+    auto forEachLine = [&](auto&& visit) {
+        size_t begin = 0;
+        while (begin < text.size())
+        {
+            size_t end = text.find('\n', begin);
+            if (end == std::string_view::npos)
+                end = text.size();
+
+            std::string_view line = text.substr(begin, end - begin);
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (!line.empty())
+                visit(line);
+
+            begin = end + 1;
+        }
+    };
+
+    size_t count = 0;
+    size_t bytes = 0;
+    forEachLine([&](std::string_view line) { ++count; bytes += line.size(); });
+
+    oligonucleotideData.resize(bytes);
+    oligonucleotides.reserve(count);
+    char* out = oligonucleotideData.data();
+    forEachLine([&](std::string_view line) {
+        std::copy(line.begin(), line.end(), out);
+        oligonucleotides.emplace_back(out, line.size());
+        out += line.size();
+    });
+}
+
+void Instance::extractInstanceInfo()
+{
+    if (oligonucleotides.empty())
+        throw std::runtime_error{ "empty spectrum" };
+
     l = oligonucleotides[0].size();
+    if (l > OverlapMatrix::MAX_WEIGHT)
+        throw std::runtime_error{ "oligonucleotide too long" };
 
     size_t dotPos = name.find('.');
     size_t plusPos = name.find('+');
@@ -39,16 +190,23 @@ void Instance::extractInstanceInfo()
 
     s = std::stoi(name.substr(dotPos + 1, numErrorsOffset - dotPos - 1));
     n = s + l - 1;
-    numErrors = std::stoi(name.substr(numErrorsOffset + 1, name.size() - numErrorsOffset));
+    size_t numErrorsLength = 0;
+    numErrors = std::stoi(name.substr(numErrorsOffset + 1, name.size() - numErrorsOffset), &numErrorsLength);
 
-    if (minusPos != std::string::npos && numErrors >= 40)
-        errorType = NEGATIVE_RANDOM;
-    else if (minusPos != std::string::npos)
-        errorType = NEGATIVE_REPEAT;
-    else if (plusPos != std::string::npos && numErrors >= 80)
-        errorType = POSITIVE_RANDOM;
-    else if (plusPos != std::string::npos)
-        errorType = POSITIVE_WRONG_ENDING;
+    const bool positive = numErrorsOffset == plusPos;
+    errorType = errorTypeOf(positive, numErrors);
+
+    size_t tagPos = numErrorsOffset + 1 + numErrorsLength;
+    if (tagPos < name.size() && name[tagPos] == '.')
+    {
+        std::string tag = name.substr(tagPos + 1, name.find('.', tagPos + 1) - tagPos - 1);
+        for (ErrorType type : { NEGATIVE_RANDOM, NEGATIVE_REPEAT, POSITIVE_RANDOM, POSITIVE_WRONG_ENDING })
+        {
+            bool positiveType = type == POSITIVE_RANDOM || type == POSITIVE_WRONG_ENDING;
+            if (positiveType == positive && tag == errorTypeTag(type))
+                errorType = type;
+        }
+    }
 
     if (errorType == NEGATIVE_RANDOM || errorType == NEGATIVE_REPEAT)
         bestSolutionSize = s - numErrors;
@@ -58,7 +216,173 @@ void Instance::extractInstanceInfo()
         bestSolutionSize = s;
 }
 
-int Instance::bestMatch(const std::string o1, const std::string o2)
+Instance::ErrorType Instance::errorTypeOf(bool positive, size_t numErrors)
+{
+    if (positive)
+        return numErrors >= 80 ? POSITIVE_RANDOM : POSITIVE_WRONG_ENDING;
+    else
+        return numErrors >= 40 ? NEGATIVE_RANDOM : NEGATIVE_REPEAT;
+}
+
+const char* Instance::errorTypeTag(ErrorType type)
+{
+    switch (type)
+    {
+    case NEGATIVE_RANDOM:
+    case POSITIVE_RANDOM:
+        return "random";
+    case NEGATIVE_REPEAT:
+        return "repeat";
+    case POSITIVE_WRONG_ENDING:
+        return "ending";
+    default:
+        return "";
+    }
+}
+
+std::filesystem::path Instance::cachePath(const InstanceOptions& options, uint64_t key) const
+{
+    // a spectrum sent over the network is known by its content alone, its name comes
+    // from the peer and may be any path
+    if (filepath.empty())
+    {
+        std::ostringstream file;
+        file << std::hex << std::setw(16) << std::setfill('0') << key << CACHE_EXTENSION;
+        return options.cacheDirectory / file.str();
+    }
+
+    std::filesystem::path directory = options.cacheDirectory.empty() ? filepath.parent_path() : options.cacheDirectory;
+    return directory / (name + CACHE_EXTENSION);
+}
+
+bool Instance::loadCache(const std::filesystem::path& path, uint64_t key)
+{
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error))
+        return false;
+
+    try
+    {
+        MappedFile file{ path };
+        CacheHeader header;
+        if (file.size() < sizeof(header))
+            return false;
+
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+            header.headerSize != sizeof(header) || header.key != key ||
+            header.weightSize != sizeof(OverlapMatrix::Weight) || header.count == 0)
+            return false;
+
+        const size_t count = header.count;
+        const size_t offsetsSize = (count + 1) * sizeof(uint64_t);
+        const size_t expectedSize = sizeof(header) + offsetsSize + header.oligonucleotideBytes + count * count;
+        if (file.size() != expectedSize)
+            return false;
+
+        std::vector<uint64_t> offsets(count + 1);
+        std::memcpy(offsets.data(), file.data() + sizeof(header), offsetsSize);
+        if (offsets[0] != 0 || offsets[count] != header.oligonucleotideBytes ||
+            !std::is_sorted(offsets.begin(), offsets.end()))
+            return false;
+
+        const char* bytes = file.data() + sizeof(header) + offsetsSize;
+        oligonucleotideData.assign(bytes, bytes + header.oligonucleotideBytes);
+        oligonucleotides.clear();
+        oligonucleotides.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+            oligonucleotides.emplace_back(oligonucleotideData.data() + offsets[i], offsets[i + 1] - offsets[i]);
+
+        n = header.n;
+        s = header.s;
+        l = header.l;
+        numErrors = header.numErrors;
+        bestSolutionSize = header.bestSolutionSize;
+        errorType = static_cast<ErrorType>(header.errorType);
+
+        const char* weights = bytes + header.oligonucleotideBytes;
+        adjMatrix.assign(count, 0);
+        for (size_t i = 0; i < count; ++i)
+            std::memcpy(adjMatrix.row(i), weights + i * count, count);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+void Instance::writeCache(const std::filesystem::path& path, uint64_t key) const
+{
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.headerSize = sizeof(header);
+    header.key = key;
+    header.n = n;
+    header.s = s;
+    header.l = l;
+    header.numErrors = numErrors;
+    header.bestSolutionSize = bestSolutionSize;
+    header.errorType = errorType;
+    header.weightSize = sizeof(OverlapMatrix::Weight);
+    header.count = oligonucleotides.size();
+
+    std::vector<uint64_t> offsets{ 0 };
+    for (std::string_view oligonucleotide : oligonucleotides)
+        offsets.push_back(offsets.back() + oligonucleotide.size());
+    header.oligonucleotideBytes = offsets.back();
+
+    // written under a name unique to this process and thread, and random for writers on
+    // other hosts sharing the directory, then renamed, so a concurrent reader never sees
+    // a partial file
+    std::ostringstream suffix;
+    suffix << ".tmp" << processId() << '.' << std::this_thread::get_id() << '.' << std::hex << std::random_device{}();
+    std::filesystem::path temporary = path;
+    temporary += suffix.str();
+    {
+        std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+        if (!file)
+            return;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        for (std::string_view oligonucleotide : oligonucleotides)
+            file.write(oligonucleotide.data(), oligonucleotide.size());
+        for (size_t i = 0; i < adjMatrix.size(); ++i)
+            file.write(reinterpret_cast<const char*>(adjMatrix.row(i)), adjMatrix.size());
+
+        if (!file)
+        {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+        std::filesystem::remove(temporary, error);
+}
+
+void Instance::packOligonucleotides()
+{
+    packedOligonucleotides.resize(oligonucleotides.size());
+    for (size_t i = 0; i < oligonucleotides.size(); ++i)
+    {
+        if (oligonucleotides[i].size() != l ||
+            !packOligonucleotide(oligonucleotides[i], packedOligonucleotides[i]))
+        {
+            packedOligonucleotides.clear();
+            return;
+        }
+    }
+}
+
+int Instance::bestMatch(std::string_view o1, std::string_view o2) const
 {
     for (size_t i = 1; i < o1.size(); ++i)
     {
@@ -83,13 +407,13 @@ std::string Instance::output(const std::vector<size_t>& solution) const
     if (solution.size() == 0)
         return "";
 
-    std::string output{oligonucleotides[solution[0]]};
+    std::string output{ oligonucleotides[solution[0]] };
     for (size_t i = 1; i < solution.size(); ++i)
     {
         size_t v1 = solution[i - 1];
         size_t v2 = solution[i];
-        size_t additionalPartLen = adjMatrix[v1][v2];
-        size_t commonPartLen = l - additionalPartLen;
+        size_t additionalPartLen = weight(v1, v2);
+        size_t commonPartLen = oligonucleotides[v2].size() - additionalPartLen;
         output += oligonucleotides[v2].substr(commonPartLen, additionalPartLen);
     }
 
@@ -98,54 +422,410 @@ std::string Instance::output(const std::vector<size_t>& solution) const
 
 size_t Instance::outputLength(const std::vector<size_t>& solution) const
 {
+	if (solution.empty())
+		return 0;
+
 	int value{};
 	for (size_t i = 0; i < solution.size() - 1; ++i)
 	{
 		size_t v1 = solution[i];
 		size_t v2 = solution[i + 1];
-		value += adjMatrix[v1][v2];
+		value += weight(v1, v2);
 	}
 
-	return value + l;
+	return value + startLength(solution[0]);
 }
 
-void Instance::buildAdjMatrix()
+Instance Instance::compacted() const
 {
-    for (size_t i = 0; i < oligonucleotides.size(); ++i)
-    {
-        adjMatrix.push_back(std::vector<int>{});
+    if (!hasAdjMatrix())
+        throw std::logic_error{ "an instance without adjMatrix cannot be compacted" };
 
-        for (size_t j = 0; j < oligonucleotides.size(); ++j)
+    const size_t size = oligonucleotides.size();
+    constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+    // next[i] is linked to i when it is the only weight-1 successor of i and i its
+    // only weight-1 predecessor
+    std::vector<size_t> next(size, NONE);
+    std::vector<uint32_t> predecessors(size, 0);
+    for (size_t i = 0; i < size; ++i)
+    {
+        const OverlapMatrix::Weight* row = adjMatrix.row(i);
+        size_t successors = 0;
+        for (size_t j = 0; j < size; ++j)
         {
-            if (i != j)
+            if (row[j] == 1)
             {
-                int weight = bestMatch(oligonucleotides[i], oligonucleotides[j]);
-                adjMatrix[i].push_back(weight);
+                ++successors;
+                ++predecessors[j];
+                next[i] = j;
             }
-            else
+        }
+        if (successors != 1)
+            next[i] = NONE;
+    }
+
+    std::vector<bool> linked(size, false); // has a linked predecessor
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (next[i] != NONE && predecessors[next[i]] == 1)
+            linked[next[i]] = true;
+        else
+            next[i] = NONE;
+    }
+
+    Instance reduced;
+    reduced.filepath = filepath;
+    reduced.errorType = errorType;
+    reduced.numErrors = numErrors;
+    reduced.n = n;
+    reduced.s = s;
+    reduced.l = l;
+    reduced.bestSolutionSize = bestSolutionSize;
+    reduced.name = name;
+
+    // weights are bytes: an edge into a chain of k weighs up to l + k - 1
+    const size_t maxChainLength = OverlapMatrix::MAX_WEIGHT + 1 - l;
+    std::vector<bool> visited(size, false);
+    reduced.chainStarts.push_back(0);
+    auto walk = [&](size_t v) {
+        while (v != NONE && !visited[v])
+        {
+            for (size_t length = 0; length < maxChainLength && v != NONE && !visited[v]; ++length)
             {
-                adjMatrix[i].push_back(std::numeric_limits<int>::max());
+                reduced.chainMembers.push_back(v);
+                visited[v] = true;
+                v = next[v];
             }
+            reduced.chainStarts.push_back(reduced.chainMembers.size());
+        }
+    };
+    // chains from their first oligonucleotide, then cycles from anywhere
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (!linked[i])
+            walk(i);
+    }
+    for (size_t i = 0; i < size; ++i)
+        walk(i);
+
+    const size_t reducedSize = reduced.chainStarts.size() - 1;
+    reduced.oligonucleotideData.resize(reducedSize * (l - 1) + size);
+    reduced.oligonucleotides.reserve(reducedSize);
+    char* out = reduced.oligonucleotideData.data();
+    for (size_t v = 0; v < reducedSize; ++v)
+    {
+        char* begin = out;
+        for (size_t m = reduced.chainStarts[v]; m < reduced.chainStarts[v + 1]; ++m)
+        {
+            // every linked oligonucleotide adds its last base
+            std::string_view oligonucleotide = oligonucleotides[reduced.chainMembers[m]];
+            if (m > reduced.chainStarts[v])
+                oligonucleotide.remove_prefix(l - 1);
+            std::memcpy(out, oligonucleotide.data(), oligonucleotide.size());
+            out += oligonucleotide.size();
+        }
+        reduced.oligonucleotides.emplace_back(begin, out - begin);
+    }
+
+    reduced.adjMatrix.assign(reducedSize, OverlapMatrix::NO_EDGE);
+    for (size_t a = 0; a < reducedSize; ++a)
+    {
+        const OverlapMatrix::Weight* row = adjMatrix.row(reduced.chainMembers[reduced.chainStarts[a + 1] - 1]);
+        OverlapMatrix::Weight* reducedRow = reduced.adjMatrix.row(a);
+        for (size_t b = 0; b < reducedSize; ++b)
+        {
+            if (a != b)
+                reducedRow[b] = (OverlapMatrix::Weight)(row[reduced.chainMembers[reduced.chainStarts[b]]] + reduced.chainLength(b) - 1);
         }
     }
+
+    return reduced;
 }
 
-void Instance::buildAdjList()
+std::vector<size_t> Instance::expand(const std::vector<size_t>& solution) const
 {
-    for (size_t i = 0; i < oligonucleotides.size(); ++i)
+    if (chainStarts.empty())
+        return solution;
+
+    std::vector<size_t> expanded;
+    expanded.reserve(countOligonucleotides(solution));
+    for (size_t v : solution)
+        expanded.insert(expanded.end(), chainMembers.begin() + chainStarts[v], chainMembers.begin() + chainStarts[v + 1]);
+    return expanded;
+}
+
+void Instance::requireEditable() const
+{
+    if (!chainStarts.empty())
+        throw std::logic_error{ "a compacted instance cannot be edited" };
+    if (!hasAdjMatrix())
+        throw std::logic_error{ "an instance without adjMatrix cannot be edited" };
+}
+
+size_t Instance::addOligonucleotide(std::string_view oligonucleotide)
+{
+    requireEditable();
+    if (oligonucleotide.size() != l)
+        throw std::invalid_argument{ "oligonucleotide of length " + std::to_string(oligonucleotide.size())
+            + " instead of " + std::to_string(l) };
+
+    // the buffer grows by half at least so that is rare, and drops the removed bytes
+    if (oligonucleotideData.size() + l > oligonucleotideData.capacity())
+        repackOligonucleotideData(std::max((oligonucleotides.size() + 1) * l, oligonucleotideData.capacity() * 3 / 2));
+    const size_t offset = oligonucleotideData.size();
+    oligonucleotideData.insert(oligonucleotideData.end(), oligonucleotide.begin(), oligonucleotide.end());
+    oligonucleotides.emplace_back(oligonucleotideData.data() + offset, l);
+
+    const size_t v = oligonucleotides.size() - 1;
+    PackedOligo packed;
+    if (!packedOligonucleotides.empty() && packOligonucleotide(oligonucleotide, packed))
+        packedOligonucleotides.push_back(packed);
+    else
+        packedOligonucleotides.clear();
+
+    adjMatrix.resize(v + 1, static_cast<OverlapMatrix::Weight>(l));
+    auto kernel = packedRowKernel<OverlapMatrix::Weight>(l);
+    if (kernel && !packedOligonucleotides.empty())
+    {
+        kernel(packedOligonucleotides[v], packedOligonucleotides.data(), v, adjMatrix.row(v));
+        for (size_t i = 0; i < v; ++i)
+            kernel(packedOligonucleotides[i], &packedOligonucleotides[v], 1, &adjMatrix(i, v));
+    }
+    else
+    {
+        for (size_t i = 0; i < v; ++i)
+        {
+            adjMatrix(v, i) = static_cast<OverlapMatrix::Weight>(bestMatch(oligonucleotides[v], oligonucleotides[i]));
+            adjMatrix(i, v) = static_cast<OverlapMatrix::Weight>(bestMatch(oligonucleotides[i], oligonucleotides[v]));
+        }
+    }
+
+    if (!candidates.empty())
+        candidates.addVertex(adjMatrix, l);
+    overlaps.clear();
+
+    edits.push_back(Edit{ Edit::ADD, v, v });
+    updateErrors();
+    return v;
+}
+
+void Instance::removeOligonucleotide(size_t v)
+{
+    requireEditable();
+    const size_t size = oligonucleotides.size();
+    if (v >= size)
+        throw std::out_of_range{ "no oligonucleotide " + std::to_string(v) };
+
+    // the bytes stay in oligonucleotideData until they outweigh the ones in use
+    const size_t last = size - 1;
+    oligonucleotides[v] = oligonucleotides[last];
+    oligonucleotides.pop_back();
+    if (!packedOligonucleotides.empty())
     {
-        adjList.push_back(std::vector<Edge>{});
+        packedOligonucleotides[v] = packedOligonucleotides[last];
+        packedOligonucleotides.pop_back();
+    }
+
+    if (v != last)
+    {
+        std::copy(adjMatrix.row(last), adjMatrix.row(last) + size, adjMatrix.row(v));
+        for (size_t i = 0; i < size; ++i)
+            adjMatrix(i, v) = adjMatrix(i, last);
+        adjMatrix(v, v) = OverlapMatrix::NO_EDGE;
+    }
+    adjMatrix.resize(last, static_cast<OverlapMatrix::Weight>(l));
+
+    if (!candidates.empty())
+        candidates.removeVertex(adjMatrix, l, v);
+    overlaps.clear();
+
+    edits.push_back(Edit{ Edit::REMOVE, v, last });
+    updateErrors();
+    if (oligonucleotideData.size() > 2 * oligonucleotides.size() * l)
+        repackOligonucleotideData(oligonucleotides.size() * l);
+}
 
-        for (size_t j = 0; j < oligonucleotides.size(); ++j)
+void Instance::updateErrors()
+{
+    // only the net count is known: oligonucleotides the sequence has that the spectrum
+    // lacks, or ones the spectrum has beyond the sequence's s
+    const size_t size = oligonucleotides.size();
+    const bool positive = size > s;
+    numErrors = positive ? size - s : s - size;
+    const bool positiveType = errorType == POSITIVE_RANDOM || errorType == POSITIVE_WRONG_ENDING;
+    if (numErrors > 0 && (errorType == NONE || positiveType != positive))
+        errorType = errorTypeOf(positive, numErrors);
+
+    // a path through the whole sequence, or through every oligonucleotide left
+    bestSolutionSize = std::min(s, size);
+}
+
+void Instance::repackOligonucleotideData(size_t capacity)
+{
+    std::vector<char> data;
+    data.reserve(capacity);
+    for (std::string_view& oligonucleotide : oligonucleotides)
+    {
+        const size_t offset = data.size();
+        data.insert(data.end(), oligonucleotide.begin(), oligonucleotide.end());
+        oligonucleotide = std::string_view{ data.data() + offset, oligonucleotide.size() };
+    }
+    oligonucleotideData = std::move(data);
+}
+
+uint64_t Instance::nextSerial()
+{
+    static std::atomic<uint64_t> next{ 1 };
+    return next++;
+}
+
+std::vector<size_t> Instance::remap(std::vector<size_t> solution, size_t since) const
+{
+    for (size_t e = since; e < edits.size(); ++e)
+    {
+        const Edit& edit = edits[e];
+        if (edit.kind != Edit::REMOVE)
+            continue;
+
+        solution.erase(std::remove(solution.begin(), solution.end(), edit.vertex), solution.end());
+        std::replace(solution.begin(), solution.end(), edit.moved, edit.vertex);
+    }
+    return solution;
+}
+
+void Instance::buildAdjMatrix()
+{
+    const size_t size = oligonucleotides.size();
+    adjMatrix.assign(size, 0);
+
+    auto kernel = packedRowKernel<OverlapMatrix::Weight>(l);
+    if (kernel && !packedOligonucleotides.empty())
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            kernel(packedOligonucleotides[i], packedOligonucleotides.data(), size, adjMatrix.row(i));
+            adjMatrix(i, i) = OverlapMatrix::NO_EDGE;
+        }
+        return;
+    }
+
+    // string fallback for probes that do not fit in a packed word
+    for (size_t i = 0; i < size; ++i)
+    {
+        for (size_t j = 0; j < size; ++j)
         {
             if (i != j)
+                adjMatrix(i, j) = static_cast<OverlapMatrix::Weight>(bestMatch(oligonucleotides[i], oligonucleotides[j]));
+        }
+    }
+}
+
+namespace
+{
+    // Chains the oligonucleotides by their m-prefix in one hash table for every overlap
+    // length m from the longest down to minOverlap, then looks the m-suffixes of one
+    // oligonucleotide after the other up in them. The first hit for a pair is its
+    // longest overlap, i.e. its smallest weight, so every row comes out in the order
+    // of SparseOverlaps without sorting and no s x s memory is touched.
+    template <typename Key, typename PrefixOf, typename SuffixOf>
+    void linkOverlaps(SparseOverlaps& overlaps, size_t size, size_t l, size_t minOverlap,
+        PrefixOf prefixOf, SuffixOf suffixOf)
+    {
+        const size_t none = size;
+        struct Level
+        {
+            std::unordered_map<Key, size_t> first; // smallest index with the prefix
+            std::vector<size_t> next; // next larger index with the same prefix
+        };
+
+        std::vector<Level> levels(l - minOverlap); // levels[l - 1 - m]
+        for (size_t m = l - 1; m >= minOverlap; --m)
+        {
+            Level& level = levels[l - 1 - m];
+            level.first.reserve(size);
+            level.next.resize(size);
+            for (size_t j = size; j-- > 0;)
             {
-                int weight = bestMatch(oligonucleotides[i], oligonucleotides[j]);
-                adjList[i].push_back(Edge{ j, weight, "" });
+                auto [it, inserted] = level.first.try_emplace(prefixOf(j, m), j);
+                level.next[j] = inserted ? none : it->second;
+                it->second = j;
+            }
+        }
+
+        overlaps.clear();
+        std::vector<size_t> listedIn(size, none); // the last row j was added to
+        for (size_t i = 0; i < size; ++i)
+        {
+            for (size_t m = l - 1; m >= minOverlap; --m)
+            {
+                const Level& level = levels[l - 1 - m];
+                auto it = level.first.find(suffixOf(i, m));
+                if (it == level.first.end())
+                    continue;
+
+                const auto weight = static_cast<OverlapMatrix::Weight>(l - m);
+                for (size_t j = it->second; j != none; j = level.next[j])
+                {
+                    if (j != i && listedIn[j] != i)
+                    {
+                        listedIn[j] = i;
+                        overlaps.add(static_cast<uint32_t>(j), weight);
+                    }
+                }
             }
+            overlaps.finishRow();
         }
+    }
+}
 
-        std::sort(adjList[i].begin(), adjList[i].end(),
-            [](const Edge& e1, const Edge& e2) { return e1.weight > e2.weight; });
+void Instance::buildOverlapsIndexed(size_t minOverlap)
+{
+    const size_t size = oligonucleotides.size();
+    if (minOverlap == 0)
+    {
+        // prefixes this long match about one random oligonucleotide of the spectrum
+        minOverlap = static_cast<size_t>(std::ceil(std::log(std::max<size_t>(size, 2)) / std::log(4.0))) + 1;
+    }
+    minOverlap = std::clamp<size_t>(minOverlap, 1, std::max<size_t>(l, 2) - 1);
+
+    if (!packedOligonucleotides.empty())
+    {
+        const auto& packed = packedOligonucleotides;
+        linkOverlaps<PackedOligo>(overlaps, size, l, minOverlap,
+            [&](size_t j, size_t m) { return packed[j] >> (2 * (l - m)); },
+            [&](size_t i, size_t m) { return packed[i] & lowMask(2 * m); });
     }
+    else
+    {
+        // string keys for probes that do not fit in a packed word
+        linkOverlaps<std::string_view>(overlaps, size, l, minOverlap,
+            [&](size_t j, size_t m) { return oligonucleotides[j].substr(0, m); },
+            [&](size_t i, size_t m) { return oligonucleotides[i].substr(l - m, m); });
+    }
+}
+
+void Instance::buildAdjMatrixIndexed(size_t minOverlap)
+{
+    buildOverlapsIndexed(minOverlap);
+
+    const size_t size = oligonucleotides.size();
+    adjMatrix.assign(size, static_cast<OverlapMatrix::Weight>(l));
+    for (size_t i = 0; i < size; ++i)
+    {
+        const uint32_t* vertices = overlaps.vertices(i);
+        const OverlapMatrix::Weight* weights = overlaps.weights(i);
+        OverlapMatrix::Weight* row = adjMatrix.row(i);
+        for (size_t e = 0; e < overlaps.count(i); ++e)
+            row[vertices[e]] = weights[e];
+    }
+}
+
+void Instance::buildCandidateLists(size_t k)
+{
+    // the overlaps are the rows already ranked, adjMatrix would be scanned whole
+    if (!overlaps.empty())
+        candidates.build(overlaps, k);
+    else
+        candidates.build(adjMatrix, l, k);
 }
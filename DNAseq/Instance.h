@@ -1,30 +1,158 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <filesystem>
-#include <fstream>
 
-struct Edge
+#include "CandidateLists.h"
+#include "OverlapMatrix.h"
+#include "PackedOligo.h"
+#include "SparseOverlaps.h"
+
+struct InstanceOptions
 {
-    size_t index; // neighbour index
-    int weight;
-    std::string sequencePart;
+    enum BuildMode
+    {
+        PAIRWISE,    // compare every ordered pair, exact weights
+        PREFIX_INDEX // hash every prefix and look suffixes up, only overlaps >= minOverlap
+    };
+
+    BuildMode buildMode = PAIRWISE;
+    size_t minOverlap = 0; // PREFIX_INDEX: weaker pairs get weight l; 0 picks the shortest overlap unlikely to be random
+    // PREFIX_INDEX: also fill the dense adjMatrix from Instance::overlaps. Only the beam
+    // search runs without it, which keeps memory O(s * l) for large spectra; such an
+    // instance is not cached and cannot be edited.
+    bool denseMatrix = true;
+    size_t candidateListSize = 0; // successors kept per oligonucleotide in Instance::candidates, 0 = none
+
+    // Load the parsed spectrum and adjMatrix from a cache file when its key matches the
+    // spectrum's content, name and build options, otherwise build them and write one.
+    bool useCache = false;
+    std::filesystem::path cacheDirectory{}; // empty = next to the spectrum
 };
 
+// extension of cache files, skip them when scanning a directory of spectra
+inline constexpr const char* CACHE_EXTENSION = ".ovl";
+
 class Instance
 {
 public:
-    Instance(std::filesystem::path filepath);
+    Instance(std::filesystem::path filepath, const InstanceOptions& options = {});
+    // from a spectrum held in memory, one oligonucleotide per line; `name` is parsed
+    // like a file name. Cached only in options.cacheDirectory, under the content's key.
+    Instance(std::string name, std::string_view spectrum, const InstanceOptions& options = {});
+
+    // oligonucleotides view oligonucleotideData, whose heap buffer survives a move
+    // but not a copy
+    Instance(Instance&&) = default;
+    Instance& operator=(Instance&&) = default;
+    Instance(const Instance&) = delete;
+    Instance& operator=(const Instance&) = delete;
+
     std::string output(const std::vector<size_t>& solution) const;
     size_t outputLength(const std::vector<size_t>& solution) const;
 
+    // Collapses every chain of oligonucleotides where each one is the only weight-1
+    // successor of the previous one and the previous one its only weight-1
+    // predecessor into one vertex with the merged sequence. The weight of an edge
+    // into a chain includes the chain's own length, so lengths and output stay exact,
+    // and solution sizes count the oligonucleotides behind every vertex. Candidate
+    // lists are not built for the result. Throws std::logic_error without adjMatrix.
+    Instance compacted() const;
+    // a solution of a compacted() instance as indices into the original one
+    std::vector<size_t> expand(const std::vector<size_t>& solution) const;
+
+    // whether adjMatrix was built, the ant colony and the local search need it
+    bool hasAdjMatrix() const { return adjMatrix.size() == oligonucleotides.size(); }
+    // the weight of i -> j from adjMatrix, or from overlaps without it
+    OverlapMatrix::Weight weight(size_t i, size_t j) const
+    {
+        if (hasAdjMatrix())
+            return adjMatrix(i, j);
+        return i == j ? OverlapMatrix::NO_EDGE : overlaps(i, j, static_cast<OverlapMatrix::Weight>(l));
+    }
+
+    // oligonucleotides vertex v stands for, 1 unless compacted
+    size_t chainLength(size_t v) const { return chainStarts.empty() ? 1 : chainStarts[v + 1] - chainStarts[v]; }
+    // length of the sequence of vertex v, what a solution starting with v begins with
+    size_t startLength(size_t v) const { return l + chainLength(v) - 1; }
+
+    // One change to the spectrum. REMOVE moved the last vertex, formerly `moved`, into
+    // `vertex`, or `moved` == `vertex` when that was the removed one.
+    struct Edit
+    {
+        enum Kind
+        {
+            ADD,
+            REMOVE
+        };
+
+        Kind kind;
+        size_t vertex;
+        size_t moved;
+    };
+
+    // Appends an oligonucleotide of length l and returns its index. Only its row and
+    // column of adjMatrix are computed, with exact weights as PAIRWISE builds them,
+    // and the candidate lists take it in, so an edit costs O(s * l). Throws
+    // std::invalid_argument for another length, std::logic_error on a compacted() one
+    // or one without adjMatrix.
+    size_t addOligonucleotide(std::string_view oligonucleotide);
+    // Removes oligonucleotide v by moving the last one into its place. O(s) besides
+    // the candidate lists that listed v. Throws like addOligonucleotide and
+    // std::out_of_range for a vertex that does not exist.
+    void removeOligonucleotide(size_t v);
+    // Both edits keep numErrors, errorType and bestSolutionSize in line with the
+    // spectrum as it is now, measured against the s oligonucleotides of the sequence.
+
+    // Edits so far. A solver that saw revision r of the instance with this serial()
+    // can carry a solution over with remap(solution, r); edits must not overlap a
+    // solver's run.
+    size_t revision() const { return edits.size(); }
+    // unique among the instances built by this process, kept by moves and edits
+    uint64_t serial() const { return id; }
+    const std::vector<Edit>& history() const { return edits; }
+    // a solution of revision `since` in today's indices, without the vertices removed since
+    std::vector<size_t> remap(std::vector<size_t> solution, size_t since) const;
+
+    template <typename Path>
+    size_t countOligonucleotides(const Path& path) const
+    {
+        if (chainStarts.empty())
+            return path.size();
+
+        size_t count = 0;
+        for (auto v : path)
+            count += chainLength(v);
+        return count;
+    }
+
 private:
+    Instance() = default;
+
+    void build(std::string_view spectrum, const InstanceOptions& options);
+    void readOligonucleotides(std::string_view text);
     void extractInstanceInfo();
-    int bestMatch(const std::string o1, const std::string o2);
+    void packOligonucleotides();
+    int bestMatch(std::string_view o1, std::string_view o2) const;
+    void requireEditable() const;
+    void updateErrors();
+    // copies the oligonucleotides into a new buffer of `capacity` bytes, without the removed ones
+    void repackOligonucleotideData(size_t capacity);
+    static uint64_t nextSerial();
+
+    std::filesystem::path cachePath(const InstanceOptions& options, uint64_t key) const;
+    bool loadCache(const std::filesystem::path& path, uint64_t key);
+    void writeCache(const std::filesystem::path& path, uint64_t key) const;
 
 public:
     void buildAdjMatrix();
-    void buildAdjList();
+    // fills overlaps from a prefix index, see InstanceOptions::PREFIX_INDEX
+    void buildOverlapsIndexed(size_t minOverlap = 0);
+    // buildOverlapsIndexed, then adjMatrix from the overlaps
+    void buildAdjMatrixIndexed(size_t minOverlap = 0);
+    void buildCandidateLists(size_t k);
 
     enum ErrorType
     {
@@ -35,15 +163,33 @@ public:
         POSITIVE_WRONG_ENDING
     };
 
+    // The type a file name `<id>.<s>(+|-)<errors>` stands for: the test corpus uses
+    // random errors from 40 negative / 80 positive ones on. A suffix `.random`,
+    // `.repeat` or `.ending` after the count names the type explicitly.
+    static ErrorType errorTypeOf(bool positive, size_t numErrors);
+    static const char* errorTypeTag(ErrorType type);
+
     std::filesystem::path filepath;
     ErrorType errorType = NONE;
     size_t numErrors = 0;
     size_t n = 0; // dna sequence length
-    size_t s = 0; // number of oligonucleotides in original spectrum
+    size_t s = 0; // oligonucleotides of the sequence, n - l + 1, whatever the spectrum holds
     size_t l = 0; // oligonucleotide length
     size_t bestSolutionSize = 0;
     std::string name{};
-    std::vector<std::string> oligonucleotides{};
-    std::vector<std::vector<int>> adjMatrix;
-    std::vector<std::vector<Edge>> adjList;
+    std::vector<std::string_view> oligonucleotides{}; // into oligonucleotideData
+    std::vector<char> oligonucleotideData{}; // every oligonucleotide back to back, and removed ones until repacked
+    std::vector<PackedOligo> packedOligonucleotides{}; // empty when l > MAX_PACKED_LENGTH or on non-ACGT input
+    OverlapMatrix adjMatrix; // empty for PREFIX_INDEX without denseMatrix
+    SparseOverlaps overlaps; // what PREFIX_INDEX found, empty for PAIRWISE, a cached instance or after edits
+    CandidateLists candidates;
+
+    // compacted(): vertex v stands for chainMembers[chainStarts[v] .. chainStarts[v + 1]),
+    // both empty otherwise
+    std::vector<size_t> chainStarts{};
+    std::vector<size_t> chainMembers{};
+
+private:
+    std::vector<Edit> edits{}; // journal of addOligonucleotide and removeOligonucleotide
+    uint64_t id = nextSerial();
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "IslandColony.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+
+IslandColony::IslandColony(const Instance& instance, const AntColony::Parameters& colony, const Parameters& parameters,
+	ThreadPool* threadPool, AntColony::Buffers* buffers)
+	: m_Instance(instance), m_Parameters(parameters), m_ThreadPool(threadPool) {
+	int islands = std::max(m_Parameters.Islands, 1);
+
+	if (!m_ThreadPool || m_ThreadPool->size() < (size_t)islands) {
+		m_OwnThreadPool = std::make_unique<ThreadPool>(islands);
+		m_ThreadPool = m_OwnThreadPool.get();
+	}
+
+	for (int i = 0; i < islands; i++) {
+		AntColony::Parameters islandParameters = colony;
+		islandParameters.Threads = 1;
+		islandParameters.Seed = colony.Seed * islands + i;
+		m_Colonies.push_back(std::make_unique<AntColony>(m_Instance, islandParameters, nullptr,
+			buffers ? &buffers[i] : nullptr));
+	}
+	m_Mailboxes = std::make_unique<Mailbox[]>(islands * islands);
+}
+
+IslandColony::~IslandColony() {}
+
+std::vector<int> IslandColony::Run(const StopCondition& stop) {
+	m_Finished = false;
+	m_ThreadPool->parallelFor(m_Colonies.size(), [&](size_t island) { RunIsland((int)island, stop); });
+
+	std::vector<int> best;
+	for (auto& colony : m_Colonies) {
+		std::vector<int> result = colony->Best();
+		if (m_Instance.countOligonucleotides(result) > m_Instance.countOligonucleotides(best)) {
+			best = std::move(result);
+		}
+	}
+	return best;
+}
+
+void IslandColony::Reinforce(const std::vector<int>& path, float weight) {
+	for (auto& colony : m_Colonies) {
+		colony->Reinforce(path, weight);
+	}
+}
+
+void IslandColony::SetMetrics(SolverMetrics* metrics) {
+	for (auto& colony : m_Colonies) {
+		colony->SetMetrics(metrics);
+	}
+}
+
+void IslandColony::RunIsland(int island, const StopCondition& stop) {
+	int islands = m_Colonies.size();
+	AntColony& colony = *m_Colonies[island];
+	size_t sentSize = 0;
+
+	for (int i = 0; !m_Finished.load(std::memory_order_relaxed); i++) {
+		// migrants arrive at iteration boundaries only
+		for (int sender = 0; sender < islands; sender++) {
+			if (std::unique_ptr<std::vector<int>> path = MailboxOf(island, sender).Take()) {
+				colony.Reinforce(*path, m_Parameters.MigrantWeight);
+			}
+		}
+
+		if (!colony.Step(stop)) {
+			break;
+		}
+
+		const std::vector<int>& best = colony.BestPath();
+		size_t bestSize = m_Instance.countOligonucleotides(best);
+		if (islands > 1 && (i + 1) % std::max(m_Parameters.MigrationInterval, 1) == 0 && bestSize > sentSize) {
+			sentSize = bestSize;
+			if (m_Parameters.Migration == Topology::RING) {
+				MailboxOf((island + 1) % islands, island).Post(best);
+			}
+			else {
+				for (int receiver = 0; receiver < islands; receiver++) {
+					if (receiver != island) {
+						MailboxOf(receiver, island).Post(best);
+					}
+				}
+			}
+			LOG_TRACE("island {}: sent a path of {} oligonucleotides", island, bestSize);
+		}
+	}
+
+	if (m_Instance.bestSolutionSize > 0 && m_Instance.countOligonucleotides(colony.BestPath()) >= m_Instance.bestSolutionSize) {
+		m_Finished = true;
+	}
+}
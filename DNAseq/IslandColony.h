@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "AntColony.h"
+
+// Several independent colonies on one instance, each with its own pheromone, run on
+// separate threads. Every MigrationInterval iterations a colony whose best path got
+// longer sends it to its neighbours, which reinforce their own trails with it.
+class IslandColony {
+
+public:
+	enum class Topology {
+		RING, // island i sends to island i + 1
+		BROADCAST // every island sends to all the others
+	};
+
+	struct Parameters {
+		int Islands = 4;
+		int MigrationInterval = 10; // iterations between sends
+		float MigrantWeight = 10.f; // a received path deposits as much as this many ants
+		Topology Migration = Topology::RING;
+	};
+
+public:
+	// `colony` is used by every island, each one building its ants on a single thread
+	// and seeded with colony.Seed * Islands + island. The islands run on `threadPool`
+	// when it has a thread for each of them, otherwise on a pool of their own. Island i
+	// reuses buffers[i] when `buffers` is given, see AntColony::Buffers.
+	IslandColony(const Instance& instance, const AntColony::Parameters& colony, const Parameters& parameters,
+		ThreadPool* threadPool = nullptr, AntColony::Buffers* buffers = nullptr);
+	~IslandColony();
+
+	// Runs every island as AntColony::Run would and returns the best solution of
+	// all of them. An island reaching Instance::bestSolutionSize stops the others.
+	std::vector<int> Run(const StopCondition& stop = StopCondition{});
+	// AntColony::Reinforce on every island
+	void Reinforce(const std::vector<int>& path, float weight);
+
+	void SetMetrics(SolverMetrics* metrics);
+
+private:
+	// Single-producer single-consumer slot holding the newest path sent and not yet
+	// taken, a newer path replaces an older one. Exchanges of one pointer, no locks.
+	class Mailbox {
+	public:
+		~Mailbox() { delete m_Path.load(std::memory_order_relaxed); }
+
+		void Post(const std::vector<int>& path) {
+			delete m_Path.exchange(new std::vector<int>(path), std::memory_order_acq_rel);
+		}
+
+		std::unique_ptr<std::vector<int>> Take() {
+			return std::unique_ptr<std::vector<int>>(m_Path.exchange(nullptr, std::memory_order_acq_rel));
+		}
+
+	private:
+		std::atomic<std::vector<int>*> m_Path{ nullptr };
+	};
+
+	void RunIsland(int island, const StopCondition& stop);
+	Mailbox& MailboxOf(int receiver, int sender) { return m_Mailboxes[receiver * m_Colonies.size() + sender]; }
+
+private:
+	const Instance& m_Instance;
+	const Parameters m_Parameters;
+	std::vector<std::unique_ptr<AntColony>> m_Colonies;
+	std::unique_ptr<Mailbox[]> m_Mailboxes; // Islands x Islands, by receiver then sender
+	std::atomic<bool> m_Finished{ false };
+	std::unique_ptr<ThreadPool> m_OwnThreadPool;
+	ThreadPool* m_ThreadPool;
+
+};
@@ -1,31 +1,144 @@
 #include "LocalSearch.h"
 #include "Logger.h"
+#include "Random.h"
 
-LocalSearch::LocalSearch(const Instance& instance, Solution solution) :
-	instance{ &instance }, bestSolution{ solution, cost(solution, &instance) }, currentSolution{ bestSolution }
+namespace
 {
+	// below this many moves a neighbourhood is scanned on the calling thread
+	constexpr size_t PARALLEL_SCAN_WORK = 1 << 14;
+
+	// odd, so it has an inverse modulo 2^64
+	constexpr uint64_t HASH_BASE = 0x9E3779B97F4A7C15ull;
+
+	uint64_t inverse(uint64_t x)
+	{
+		// Newton's iteration doubles the number of correct low bits every step
+		uint64_t y = x;
+		for (int i = 0; i < 5; ++i)
+			y *= 2 - x * y;
+		return y;
+	}
+}
+
+LocalSearch::LocalSearch(const Instance& instance, Solution solution, bool useCandidateLists, TabuMode tabuMode,
+	ThreadPool* threadPool, Scratch* scratch) :
+	instance{ &instance }, bestSolution{ solution, cost(solution, &instance), instance.countOligonucleotides(solution) },
+	currentSolution{ bestSolution },
+	useCandidateLists{ useCandidateLists && !instance.candidates.empty() }, tabuMode{ tabuMode },
+	threadPool{ threadPool }, scratch{ scratch }
+{
+	const size_t size = instance.adjMatrix.size();
+
+	if (scratch)
+	{
+		vertexKeys = std::move(scratch->vertexKeys);
+		powers = std::move(scratch->powers);
+		inversePowers = std::move(scratch->inversePowers);
+		used = std::move(scratch->used);
+		position = std::move(scratch->position);
+		forwardCost = std::move(scratch->forwardCost);
+		backwardCost = std::move(scratch->backwardCost);
+		prefixHash = std::move(scratch->prefixHash);
+		reversePrefixHash = std::move(scratch->reversePrefixHash);
+	}
+
+	// the keys come from a fixed seed, so tables kept from a larger instance start
+	// with the ones this instance needs
+	if (vertexKeys.size() < size)
+	{
+		CounterRng random{ 0x5DEECE66Dull };
+		vertexKeys.resize(size);
+		for (uint64_t& key : vertexKeys)
+			key = random.nextUInt64();
+
+		const uint64_t inverseBase = inverse(HASH_BASE);
+		powers.resize(size + 1);
+		inversePowers.resize(size + 1);
+		powers[0] = inversePowers[0] = 1;
+		for (size_t p = 1; p <= size; ++p)
+		{
+			powers[p] = powers[p - 1] * HASH_BASE;
+			inversePowers[p] = inversePowers[p - 1] * inverseBase;
+		}
+	}
+
+	used.assign((size + 63) / 64, 0);
+	for (size_t v : currentSolution.solution)
+		used[v / 64] |= uint64_t{ 1 } << (v % 64);
+
+	currentSolution.solution.reserve(size);
+	bestSolution.solution.reserve(size);
+	position.reserve(size);
+	forwardCost.reserve(size + 1);
+	backwardCost.reserve(size + 1);
+	prefixHash.reserve(size + 1);
+	reversePrefixHash.reserve(size + 1);
 }
 
-Solution LocalSearch::run(size_t tabuSize, size_t numIterations, size_t k)
+LocalSearch::~LocalSearch()
+{
+	if (scratch)
+	{
+		scratch->vertexKeys = std::move(vertexKeys);
+		scratch->powers = std::move(powers);
+		scratch->inversePowers = std::move(inversePowers);
+		scratch->used = std::move(used);
+		scratch->position = std::move(position);
+		scratch->forwardCost = std::move(forwardCost);
+		scratch->backwardCost = std::move(backwardCost);
+		scratch->prefixHash = std::move(prefixHash);
+		scratch->reversePrefixHash = std::move(reversePrefixHash);
+	}
+}
+
+Solution LocalSearch::run(size_t tabuSize, size_t numIterations, size_t k, const StopCondition& stop, size_t maxStagnation)
 {
 	if (!isValid(bestSolution, instance))
 		throw std::exception{};
 
-	tabuList = std::vector<RankedSolution>{};
+	// a move breaks up to two edges
+	tabu.reset(tabuMode == TabuMode::SOLUTIONS ? tabuSize : 2 * tabuSize);
+	size_t lastImprovement = 0;
 	for (size_t i = 0; i < numIterations; ++i)
 	{
+		const size_t target = instance->bestSolutionSize;
+		if ((target > 0 && bestSolution.oligonucleotides >= target) || stop.stopRequested())
+			break;
+
+		if (maxStagnation > 0 && i - lastImprovement >= maxStagnation)
+		{
+			LOG_TRACE("local search: no improvement for {} steps", maxStagnation);
+			break;
+		}
+
 		LOG_TRACE("local search: {} / {}", i + 1, numIterations);
 
-		currentSolution = getBestNeighbour(k);
+		SolverMetrics::Clock::time_point stepStart;
+		if (metrics)
+			stepStart = SolverMetrics::Clock::now();
 
-		if (currentSolution.solution.size() == 0)
-			return bestSolution.solution;
+		Move move = getBestNeighbour(k);
+		if (move.type != Move::NONE)
+		{
+			applyMove(move);
+			if (tabuMode == TabuMode::SOLUTIONS)
+				tabu.push(move.hash);
+		}
 
-		tabuList.push_back(currentSolution);
+		// a scan without a move is timed as well, its neighbours were counted
+		if (metrics)
+		{
+			SolverMetrics::add(metrics->localSearchSteps, move.type != Move::NONE);
+			SolverMetrics::addElapsed(metrics->localSearchNanoseconds, stepStart);
+		}
+
+		if (move.type == Move::NONE)
+			return bestSolution.solution;
 
 		if (currentSolution > bestSolution)
 		{
 			bestSolution = currentSolution;
+			lastImprovement = i + 1;
 			LOG_TRACE("Found improvement");
 		}
 	}
@@ -33,90 +146,242 @@ Solution LocalSearch::run(size_t tabuSize, size_t numIterations, size_t k)
 	return bestSolution.solution;
 }
 
-Solution do2Opt(const Solution& path, size_t i, size_t j)
+Move LocalSearch::getBestNeighbour(size_t k)
 {
-	Solution pathCopy{ path };
-	std::reverse(pathCopy.begin() + i, pathCopy.begin() + j + 1);
+	const Solution& solution = currentSolution.solution;
+	const OverlapMatrix& dist = instance->adjMatrix;
+	const size_t n = solution.size();
+	const size_t size = dist.size();
+	const int currentCost = currentSolution.cost;
+	const size_t currentSize = currentSolution.oligonucleotides;
 
-	return pathCopy;
-}
+	ScanBest bestNeighbour{};
+	// moves are ranked from their delta cost, only a move that beats the best one so
+	// far is checked against the tabu list; `first` is the first vertex after the move
+	auto consider = [&](ScanBest& best, const Move& neighbour, size_t first) {
+		++best.evaluated;
+		if (neighbour.cost + instance->startLength(first) <= instance->n && neighbour > best.move && !isTabu(neighbour))
+			best.move = neighbour;
+	};
+	auto result = [&]() {
+		if (metrics)
+			SolverMetrics::add(metrics->neighboursEvaluated, bestNeighbour.evaluated);
+		return bestNeighbour.move;
+	};
 
-Solution addVertex(const Solution& path, size_t index, size_t vertex)
-{
-	Solution newPath{ path };
-	newPath.insert(newPath.begin() + index, vertex);
+	// Runs body(best, index) for index 0 .. count - 1 of an outer loop. On the thread
+	// pool the range is split into chunks that keep their own best move, merged in
+	// chunk order, so ties still go to the first move in scan order and the result
+	// does not depend on the number of threads.
+	auto scan = [&](size_t count, size_t workPerIndex, const auto& body) {
+		size_t chunks = 1;
+		if (threadPool && count * workPerIndex >= PARALLEL_SCAN_WORK)
+			chunks = std::min(count, threadPool->size() * 4);
 
-	return newPath;
-}
+		if (chunks <= 1)
+		{
+			for (size_t index = 0; index < count; ++index)
+				body(bestNeighbour, index);
+			return;
+		}
 
-RankedSolution LocalSearch::getBestNeighbour(size_t k)
-{
-	RankedSolution bestNeighbour{};
-	const size_t n = currentSolution.solution.size();
+		chunkBest.assign(chunks, ScanBest{});
+		threadPool->parallelFor(chunks, [&](size_t chunk) {
+			const size_t last = count * (chunk + 1) / chunks;
+			for (size_t index = count * chunk / chunks; index < last; ++index)
+				body(chunkBest[chunk], index);
+		});
 
-	std::vector<size_t> newVertices{};
-	for (size_t i = 0; i < instance->adjMatrix.size(); ++i)
-	{
-		if (std::find(currentSolution.solution.begin(),
-			currentSolution.solution.end(), i) == currentSolution.solution.end())
+		for (const ScanBest& best : chunkBest)
 		{
-			newVertices.push_back(i);
+			bestNeighbour.evaluated += best.evaluated;
+			if (best.move.type != Move::NONE && best.move > bestNeighbour.move)
+				bestNeighbour.move = best.move;
 		}
+	};
+
+	auto tryInsert = [&](ScanBest& best, size_t i, size_t v) {
+		int c = currentCost;
+		if (n == 0)
+			c = 0;
+		else if (i == 0)
+			c += dist(v, solution[0]);
+		else if (i == n)
+			c += dist(solution[n - 1], v);
+		else
+			c += dist(solution[i - 1], v) + dist(v, solution[i]) - dist(solution[i - 1], solution[i]);
+
+		const uint64_t h = prefixHash[i] + vertexKeys[v] * powers[i] + HASH_BASE * (prefixHash[n] - prefixHash[i]);
+		consider(best, Move{ Move::INSERT, i, v, currentSize + instance->chainLength(v), c, h }, i == 0 ? v : solution[0]);
+	};
+	auto isUsed = [&](size_t v) { return (used[v / 64] >> (v % 64)) & 1; };
+
+	prefixHash.assign(n + 1, 0);
+	reversePrefixHash.assign(n + 1, 0);
+	for (size_t p = 0; p < n; ++p)
+	{
+		prefixHash[p + 1] = prefixHash[p] + vertexKeys[solution[p]] * powers[p];
+		reversePrefixHash[p + 1] = reversePrefixHash[p] + vertexKeys[solution[p]] * inversePowers[p];
 	}
 
-	// try to add new vertex on every position
-	bool found = false;
-	for (size_t v : newVertices)
+	if (useCandidateLists)
 	{
-		for (size_t i = 0; i <= n; ++i)
-		{
-			Solution neighbourSolution = addVertex(currentSolution.solution, i, v);
-			int c = cost(neighbourSolution, instance);
-			RankedSolution neighbour = { std::move(neighbourSolution), c};
-			if (isValid(neighbour, instance) && !isTabu(neighbour))
+		position.assign(size, std::numeric_limits<size_t>::max());
+		for (size_t i = 0; i < n; ++i)
+			position[solution[i]] = i;
+	}
+
+	// try to add new vertex on every position, with candidate lists only the
+	// insertions that create at least one candidate edge
+	if (useCandidateLists)
+	{
+		const CandidateLists& candidates = instance->candidates;
+		scan(n, candidates.maxCandidates(), [&](ScanBest& best, size_t index) {
+			const size_t prev = solution[index];
+			for (size_t c = 0; c < candidates.count(prev); ++c)
 			{
-				if (neighbour > bestNeighbour)
-				{
-					bestNeighbour = neighbour;
-					found = true;
-				}
+				if (!isUsed(candidates.vertices(prev)[c]))
+					tryInsert(best, index + 1, candidates.vertices(prev)[c]);
 			}
-		}
+		});
+		scan(size, candidates.maxCandidates(), [&](ScanBest& best, size_t v) {
+			if (isUsed(v))
+				return;
+
+			for (size_t c = 0; c < candidates.count(v); ++c)
+			{
+				const size_t next = candidates.vertices(v)[c];
+				if (isUsed(next))
+					tryInsert(best, position[next], v);
+			}
+		});
 	}
+	else
+	{
+		scan(size, n + 1, [&](ScanBest& best, size_t v) {
+			if (isUsed(v))
+				return;
 
-	if (found)
-		return bestNeighbour;
+			for (size_t i = 0; i <= n; ++i)
+				tryInsert(best, i, v);
+		});
+	}
 
-	// try edge swapping
-	for (int i = 0; i <= n - k; i++)
+	if (bestNeighbour.move.type != Move::NONE || n < k)
+		return result();
+
+	// reversing [i, j] replaces the edges (i - 1, i) and (j, j + 1) with (i - 1, j) and
+	// (i, j + 1) and walks the edges in between backwards, which prefix sums over both
+	// directions price in O(1)
+	forwardCost.assign(n, 0);
+	backwardCost.assign(n, 0);
+	for (size_t q = 0; q + 1 < n; ++q)
 	{
-		for (int j = i + 1; j <= n + 1 - k; j++)
-		{
-			const auto& dist = instance->adjMatrix;
-			int costDelta = dist[i][(i + 1) % n] - dist[j][(j + 1) % n] + dist[i][j] + dist[(i + 1) % n][(j + 1) % n];
+		forwardCost[q + 1] = forwardCost[q] + dist(solution[q], solution[q + 1]);
+		backwardCost[q + 1] = backwardCost[q] + dist(solution[q + 1], solution[q]);
+	}
+
+	auto tryReverse = [&](ScanBest& best, size_t i, size_t j) {
+		int c = currentCost - (forwardCost[j] - forwardCost[i]) + (backwardCost[j] - backwardCost[i]);
+		if (i > 0)
+			c += dist(solution[i - 1], solution[j]) - dist(solution[i - 1], solution[i]);
+		if (j + 1 < n)
+			c += dist(solution[i], solution[j + 1]) - dist(solution[j], solution[j + 1]);
+
+		// the reversed segment contributes key[s[p]] * BASE^(i + j - p)
+		const uint64_t h = prefixHash[n] - (prefixHash[j + 1] - prefixHash[i])
+			+ powers[i + j] * (reversePrefixHash[j + 1] - reversePrefixHash[i]);
+		consider(best, Move{ Move::REVERSE, i, j, currentSize, c, h }, i == 0 ? solution[j] : solution[0]);
+	};
+
+	// reversing [i, j] creates the edges (i - 1, j) and (i, j + 1), with candidate lists
+	// only the swaps where one of them is a candidate edge are tried
+	if (useCandidateLists)
+	{
+		const CandidateLists& candidates = instance->candidates;
+		scan(n - k + 1, 2 * candidates.maxCandidates(), [&](ScanBest& best, size_t i) {
+			if (i > 0)
+			{
+				const size_t prev = solution[i - 1];
+				for (size_t c = 0; c < candidates.count(prev); ++c)
+				{
+					const size_t j = position[candidates.vertices(prev)[c]];
+					if (j != std::numeric_limits<size_t>::max() && j > i && j <= n + 1 - k)
+						tryReverse(best, i, j);
+				}
+			}
 
-			Solution neighbourSolution = do2Opt(currentSolution.solution, i, j);
-			int c = cost(neighbourSolution, instance);
-			RankedSolution neighbour = { std::move(neighbourSolution), c};
-			if (isValid(neighbour, instance) && !isTabu(neighbour))
+			const size_t first = solution[i];
+			for (size_t c = 0; c < candidates.count(first); ++c)
 			{
-				if (neighbour > bestNeighbour)
-					bestNeighbour = neighbour;
+				const size_t next = position[candidates.vertices(first)[c]];
+				if (next != std::numeric_limits<size_t>::max() && next > i + 1 && next - 1 <= n + 1 - k)
+					tryReverse(best, i, next - 1);
 			}
-		}
+		});
+	}
+	else
+	{
+		// try edge swapping
+		scan(n - k + 1, n - k + 1, [&](ScanBest& best, size_t i) {
+			for (size_t j = i + 1; j <= n + 1 - k; j++)
+				tryReverse(best, i, j);
+		});
 	}
 
-	return bestNeighbour;
+	return result();
 }
 
-bool LocalSearch::isTabu(const RankedSolution& solution)
+void LocalSearch::applyMove(const Move& move)
 {
-	for (const auto& s : tabuList)
+	Solution& solution = currentSolution.solution;
+	if (tabuMode == TabuMode::ATTRIBUTES)
 	{
-		if (s == solution)
-			return true;
+		if (move.type == Move::INSERT && move.i > 0 && move.i < solution.size())
+			tabu.push(edgeKey(solution[move.i - 1], solution[move.i]));
+
+		if (move.type == Move::REVERSE)
+		{
+			if (move.i > 0)
+				tabu.push(edgeKey(solution[move.i - 1], solution[move.i]));
+			if (move.j + 1 < solution.size())
+				tabu.push(edgeKey(solution[move.j], solution[move.j + 1]));
+		}
 	}
 
+	if (move.type == Move::INSERT)
+	{
+		solution.insert(solution.begin() + move.i, move.j);
+		used[move.j / 64] |= uint64_t{ 1 } << (move.j % 64);
+	}
+	else if (move.type == Move::REVERSE)
+	{
+		std::reverse(solution.begin() + move.i, solution.begin() + move.j + 1);
+	}
+	currentSolution.cost = move.cost;
+	currentSolution.oligonucleotides = move.size;
+}
+
+bool LocalSearch::isTabu(const Move& move) const
+{
+	if (tabuMode == TabuMode::SOLUTIONS)
+		return tabu.contains(move.hash);
+
+	// an insertion only creates edges to a new vertex, so it cannot undo anything
+	if (move.type != Move::REVERSE)
+		return false;
+
+	// aspiration: a move leading to a new best solution is always allowed
+	if (move.size > bestSolution.oligonucleotides ||
+		(move.size == bestSolution.oligonucleotides && move.cost < bestSolution.cost))
+		return false;
+
+	const Solution& solution = currentSolution.solution;
+	if (move.i > 0 && tabu.contains(edgeKey(solution[move.i - 1], solution[move.j])))
+		return true;
+	if (move.j + 1 < solution.size() && tabu.contains(edgeKey(solution[move.i], solution[move.j + 1])))
+		return true;
+
 	return false;
 }
 
@@ -127,7 +392,7 @@ int cost(const Solution& solution, const Instance* instance)
 	{
 		size_t v1 = solution[i];
 		size_t v2 = solution[i + 1];
-		value += instance->adjMatrix[v1][v2];
+		value += instance->adjMatrix(v1, v2);
 	}
 
 	return value;
@@ -135,7 +400,9 @@ int cost(const Solution& solution, const Instance* instance)
 
 size_t outputLength(const RankedSolution& solution, const Instance* instance)
 {
-	return solution.cost + instance->l;
+	if (solution.solution.empty())
+		return instance->l;
+	return solution.cost + instance->startLength(solution.solution[0]);
 }
 
 bool isValid(const RankedSolution& solution, const Instance* instance)
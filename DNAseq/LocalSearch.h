@@ -1,5 +1,9 @@
 #pragma once
 #include "Instance.h"
+#include "Metrics.h"
+#include "StopCondition.h"
+#include "TabuMemory.h"
+#include "ThreadPool.h"
 
 using Solution = std::vector<size_t>;
 
@@ -7,12 +11,13 @@ struct RankedSolution
 {
 	Solution solution;
 	int cost;
+	size_t oligonucleotides; // Instance::countOligonucleotides(solution)
 
 	bool operator>(const RankedSolution& other) const
 	{
-		if (solution.size() > other.solution.size())
+		if (oligonucleotides > other.oligonucleotides)
 			return true;
-		else if (solution.size() < other.solution.size())
+		else if (oligonucleotides < other.oligonucleotides)
 			return false;
 		else
 			return (cost < other.cost);
@@ -35,21 +40,111 @@ struct RankedSolution
 
 using Neighbours = std::vector<RankedSolution>;
 
+// A neighbour described by the move leading to it from the current solution, so it can
+// be ranked from its delta cost without building it.
+struct Move
+{
+	enum Type
+	{
+		NONE,
+		INSERT, // insert vertex `j` before position `i`
+		REVERSE // reverse positions `i` .. `j`
+	};
+
+	Type type = NONE;
+	size_t i = 0;
+	size_t j = 0;
+	size_t size = 0; // oligonucleotides in the solution after the move
+	int cost = 0; // solution cost after the move
+	uint64_t hash = 0; // of the solution after the move
+
+	// same order as RankedSolution
+	bool operator>(const Move& other) const
+	{
+		if (size != other.size)
+			return size > other.size;
+		else
+			return (cost < other.cost);
+	}
+};
+
 class LocalSearch
 {
 public:
-	LocalSearch(const Instance& instance, Solution solution);
-	Solution run(size_t tabuSize = 30, size_t numIterations = 100, size_t k = 2);
+	enum class TabuMode
+	{
+		SOLUTIONS, // the last tabuSize visited solutions, compared by hash
+		ATTRIBUTES // reversals recreating an edge broken by the last tabuSize moves
+	};
+
+	// The O(size) tables and buffers of a search. A search given Scratch takes it over
+	// and hands it back when destroyed, so searches run one after another reuse it.
+	struct Scratch
+	{
+		std::vector<uint64_t> vertexKeys;
+		std::vector<uint64_t> powers;
+		std::vector<uint64_t> inversePowers;
+		std::vector<uint64_t> used;
+		std::vector<size_t> position;
+		std::vector<int> forwardCost;
+		std::vector<int> backwardCost;
+		std::vector<uint64_t> prefixHash;
+		std::vector<uint64_t> reversePrefixHash;
+	};
+
+	// neighbourhoods are scanned on threadPool when given, `scratch` is reused when given
+	LocalSearch(const Instance& instance, Solution solution, bool useCandidateLists = false,
+		TabuMode tabuMode = TabuMode::SOLUTIONS, ThreadPool* threadPool = nullptr, Scratch* scratch = nullptr);
+	~LocalSearch();
+
+	LocalSearch(const LocalSearch&) = delete;
+	LocalSearch& operator=(const LocalSearch&) = delete;
+
+	// Stops early on `stop`, after maxStagnation steps without improvement (0 = never) or
+	// once Instance::bestSolutionSize is reached, and returns the best solution found.
+	Solution run(size_t tabuSize = 30, size_t numIterations = 100, size_t k = 2,
+		const StopCondition& stop = StopCondition{}, size_t maxStagnation = 0);
+	// counts steps and evaluated neighbours into `metrics` when not null
+	void setMetrics(SolverMetrics* metrics) { this->metrics = metrics; }
 
 
 private:
-	RankedSolution getBestNeighbour(size_t k);
-	bool isTabu(const RankedSolution& solution);
+	// best move of a scan, or of one chunk of it, and the number of moves priced
+	struct ScanBest
+	{
+		Move move;
+		size_t evaluated = 0;
+	};
+
+	Move getBestNeighbour(size_t k);
+	void applyMove(const Move& move);
+	bool isTabu(const Move& move) const;
+	uint64_t edgeKey(size_t v1, size_t v2) const { return v1 * instance->adjMatrix.size() + v2; }
 
 	const Instance* instance;
 	RankedSolution bestSolution;
 	RankedSolution currentSolution;
-	std::vector<RankedSolution> tabuList;
+	bool useCandidateLists; // restrict neighbourhoods to moves creating a candidate edge
+	TabuMode tabuMode;
+	TabuMemory tabu;
+	ThreadPool* threadPool;
+	SolverMetrics* metrics = nullptr;
+	Scratch* scratch; // where the tables and buffers go back to, or null
+
+	// Solutions are hashed as sum(key[s[p]] * BASE^p) mod 2^64, so the hash of a
+	// neighbour follows in O(1) from prefix hashes of the current solution.
+	std::vector<uint64_t> vertexKeys;
+	std::vector<uint64_t> powers; // BASE^p
+	std::vector<uint64_t> inversePowers; // BASE^-p
+
+	// scratch reused by every step
+	std::vector<uint64_t> used; // bitset of the vertices in currentSolution
+	std::vector<size_t> position; // of every vertex in currentSolution, only with candidate lists
+	std::vector<int> forwardCost; // forwardCost[k] = cost of the first k edges
+	std::vector<int> backwardCost; // backwardCost[k] = cost of the first k edges walked backwards
+	std::vector<uint64_t> prefixHash; // prefixHash[k] = sum(key[s[p]] * BASE^p), p < k
+	std::vector<uint64_t> reversePrefixHash; // reversePrefixHash[k] = sum(key[s[p]] * BASE^-p), p < k
+	std::vector<ScanBest> chunkBest; // of every chunk of a parallel scan
 };
 
 int cost(const Solution& solution, const Instance* instance);
@@ -1,13 +1,55 @@
 #include "Logger.h"
 
+#include <cstdlib>
+
+#include "spdlog/async.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
 std::shared_ptr<spdlog::logger> Logger::s_Logger;
 
-void Logger::Init() {
-	spdlog::sink_ptr logSink = std::make_shared<spdlog::sinks::wincolor_stdout_sink_mt>();
-	logSink->set_pattern("%^[%T] %l: %v%$");
+static const char* PATTERN = "%^[%T] %l: %v%$";
+
+void Logger::Init(spdlog::level::level_enum level) {
+	if (s_Logger) {
+		s_Logger->set_level(level);
+		return;
+	}
+
+	// lines are formatted on the calling thread and written by one background thread,
+	// which flushes on warnings and otherwise every second
+	spdlog::init_thread_pool(8192, 1);
+	spdlog::sink_ptr logSink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+	logSink->set_pattern(PATTERN);
+
+	s_Logger = std::make_shared<spdlog::async_logger>("logger", logSink, spdlog::thread_pool(), spdlog::async_overflow_policy::block);
+	spdlog::register_logger(s_Logger);
+
+	s_Logger->set_level(level);
+	s_Logger->flush_on(spdlog::level::warn);
+	spdlog::flush_every(std::chrono::seconds(1));
+
+	std::atexit(Logger::Shutdown);
+}
+
+void Logger::UseStderr() {
+	// a new logger, messages the old one queued keep it alive until they are written
+	spdlog::sink_ptr logSink = std::make_shared<spdlog::sinks::stderr_color_sink_mt>();
+	logSink->set_pattern(PATTERN);
+	spdlog::level::level_enum level = s_Logger->level();
+	spdlog::drop("logger");
+
+	s_Logger = std::make_shared<spdlog::async_logger>("logger", logSink, spdlog::thread_pool(), spdlog::async_overflow_policy::block);
+	spdlog::register_logger(s_Logger);
+	s_Logger->set_level(level);
+	s_Logger->flush_on(spdlog::level::warn);
+}
 
-	s_Logger = std::make_shared<spdlog::logger>("logger", logSink);
+void Logger::Shutdown() {
+	if (!s_Logger) {
+		return;
+	}
 
-	s_Logger->set_level(spdlog::level::trace);
-	s_Logger->flush_on(spdlog::level::trace);
-}
\ No newline at end of file
+	s_Logger->flush();
+	s_Logger.reset();
+	spdlog::shutdown();
+}
@@ -7,7 +7,13 @@
 class Logger {
 
 public:
-	static void Init();
+	// asynchronous console logger, messages below `level` are dropped
+	static void Init(spdlog::level::level_enum level = spdlog::level::info);
+	// writes to stderr from now on, for when stdout carries other output; to be
+	// called before other threads log
+	static void UseStderr();
+	// flushes pending messages, also run at exit
+	static void Shutdown();
 
 	static std::shared_ptr<spdlog::logger>& GetLogger() { return s_Logger; }
 
@@ -33,7 +39,8 @@ private:
 		#define LOG_ERROR(...)    ::Logger::GetLogger()->error(__VA_ARGS__)
 		#define LOG_CRITICAL(...) ::Logger::GetLogger()->critical(__VA_ARGS__)
 	#else
-		#define LOG_TRACE(...)
+		// arguments are only evaluated when trace messages are enabled
+		#define LOG_TRACE(...)    do { if (::Logger::GetLogger()->should_log(spdlog::level::trace)) ::Logger::GetLogger()->trace(__VA_ARGS__); } while (0)
 		#define LOG_INFO(...)     ::Logger::GetLogger()->info(__VA_ARGS__)
 		#define LOG_WARN(...)     ::Logger::GetLogger()->warn(__VA_ARGS__)
 		#define LOG_ERROR(...)    ::Logger::GetLogger()->error(__VA_ARGS__)
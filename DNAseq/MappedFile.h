@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+// A whole file mapped read-only into memory, unmapped on destruction.
+class MappedFile
+{
+public:
+    // throws std::runtime_error when the file cannot be opened or mapped
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+    std::string_view view() const { return { bytes, length }; }
+
+private:
+    void unmap();
+
+    const char* bytes = nullptr;
+    size_t length = 0;
+};
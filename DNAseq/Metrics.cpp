@@ -0,0 +1,49 @@
+#include "Metrics.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    double milliseconds(const std::atomic<uint64_t>& nanoseconds)
+    {
+        return nanoseconds.load(std::memory_order_relaxed) / 1e6;
+    }
+
+    double perSecond(const std::atomic<uint64_t>& count, const std::atomic<uint64_t>& nanoseconds)
+    {
+        uint64_t elapsed = nanoseconds.load(std::memory_order_relaxed);
+        return elapsed == 0 ? 0.0 : count.load(std::memory_order_relaxed) * 1e9 / elapsed;
+    }
+
+    std::string escape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+std::string SolverMetrics::toJson(const std::string& instance) const
+{
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3)
+         << "{\"instance\":\"" << escape(instance) << '"'
+         << ",\"load_ms\":" << milliseconds(loadNanoseconds)
+         << ",\"ants\":" << antsBuilt.load(std::memory_order_relaxed)
+         << ",\"ant_ms\":" << milliseconds(antNanoseconds)
+         << ",\"ants_per_second\":" << perSecond(antsBuilt, antNanoseconds)
+         << ",\"pheromone_updates\":" << pheromoneUpdates.load(std::memory_order_relaxed)
+         << ",\"pheromone_update_ms\":" << milliseconds(pheromoneNanoseconds)
+         << ",\"neighbours\":" << neighboursEvaluated.load(std::memory_order_relaxed)
+         << ",\"local_search_steps\":" << localSearchSteps.load(std::memory_order_relaxed)
+         << ",\"local_search_ms\":" << milliseconds(localSearchNanoseconds)
+         << ",\"neighbours_per_second\":" << perSecond(neighboursEvaluated, localSearchNanoseconds)
+         << '}';
+    return json.str();
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Throughput counters of one solver run. The solvers add to them once per
+// iteration or scan chunk with relaxed atomics, so a run can be watched from
+// another thread without slowing the hot paths down.
+struct SolverMetrics
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<uint64_t> loadNanoseconds{ 0 };
+    std::atomic<uint64_t> antsBuilt{ 0 };
+    std::atomic<uint64_t> antNanoseconds{ 0 }; // building ant paths
+    std::atomic<uint64_t> pheromoneUpdates{ 0 };
+    std::atomic<uint64_t> pheromoneNanoseconds{ 0 }; // evaporation, deposits and choice info
+    std::atomic<uint64_t> neighboursEvaluated{ 0 };
+    std::atomic<uint64_t> localSearchSteps{ 0 };
+    std::atomic<uint64_t> localSearchNanoseconds{ 0 };
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t value)
+    {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    static void addElapsed(std::atomic<uint64_t>& counter, Clock::time_point since)
+    {
+        add(counter, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - since).count());
+    }
+
+    // one JSON object on a single line, with the rates derived from the counters
+    std::string toJson(const std::string& instance) const;
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <vector>
+
+template <typename T, size_t Alignment>
+struct AlignedAllocator
+{
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{ Alignment }));
+    }
+
+    void deallocate(T* pointer, size_t)
+    {
+        ::operator delete(pointer, std::align_val_t{ Alignment });
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+// Dense s x s overlap weights in one row-major allocation. Weights are in 1..l so a
+// byte is enough; every row starts on its own cache line and is padded to a whole
+// number of lines, so a row can be streamed with aligned vector loads.
+class OverlapMatrix
+{
+public:
+    using Weight = uint8_t;
+
+    static constexpr Weight NO_EDGE = std::numeric_limits<Weight>::max(); // diagonal
+    static constexpr size_t MAX_WEIGHT = NO_EDGE - 1;
+    static constexpr size_t ALIGNMENT = 64;
+
+    OverlapMatrix() = default;
+    OverlapMatrix(size_t size, Weight fill) { assign(size, fill); }
+
+    // resizes to size x size, fills with `fill` and puts NO_EDGE on the diagonal
+    void assign(size_t size, Weight fill)
+    {
+        count = size;
+        rowStride = roundUp(size);
+        data.assign(count * rowStride, fill);
+        for (size_t i = 0; i < count; ++i)
+            data[i * rowStride + i] = NO_EDGE;
+    }
+
+    // Resizes to size x size keeping the weights among the first min(size, size())
+    // vertices; new entries are `fill` with NO_EDGE on the diagonal. Rows are only
+    // copied when the stride has to grow, and then by a quarter at least, so adding
+    // vertices one at a time moves the matrix rarely.
+    void resize(size_t size, Weight fill)
+    {
+        const size_t kept = std::min(size, count);
+        const size_t stride = roundUp(size);
+        if (stride > rowStride)
+        {
+            const size_t wider = std::max(stride, roundUp(rowStride + rowStride / 4));
+            std::vector<Weight, AlignedAllocator<Weight, ALIGNMENT>> widened(size * wider, fill);
+            for (size_t i = 0; i < kept; ++i)
+                std::copy(row(i), row(i) + kept, widened.data() + i * wider);
+            data.swap(widened);
+            rowStride = wider;
+        }
+        else
+        {
+            data.resize(size * rowStride, fill);
+            for (size_t i = 0; i < kept; ++i)
+                std::fill(row(i) + kept, row(i) + size, fill);
+        }
+
+        for (size_t i = kept; i < size; ++i)
+            data[i * rowStride + i] = NO_EDGE;
+        count = size;
+    }
+
+    size_t size() const { return count; }
+    size_t stride() const { return rowStride; }
+
+    Weight operator()(size_t i, size_t j) const { return data[i * rowStride + j]; }
+    Weight& operator()(size_t i, size_t j) { return data[i * rowStride + j]; }
+
+    const Weight* row(size_t i) const { return data.data() + i * rowStride; }
+    Weight* row(size_t i) { return data.data() + i * rowStride; }
+
+private:
+    static size_t roundUp(size_t size) { return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    size_t count = 0;
+    size_t rowStride = 0;
+    std::vector<Weight, AlignedAllocator<Weight, ALIGNMENT>> data;
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+// Oligonucleotides of up to 32 bases are stored as 2 bits per base (A=0, C=1, G=2, T=3)
+// with the first base in the most significant used bits. For an oligonucleotide of
+// length l the prefix of length m is then `word >> 2 * (l - m)` and the suffix of
+// length m is `word & lowMask(2 * m)`, so an overlap test is one shift, one mask and one compare.
+constexpr size_t MAX_PACKED_LENGTH = 32;
+
+using PackedOligo = uint64_t;
+
+inline bool packOligonucleotide(std::string_view oligo, PackedOligo& packed)
+{
+    if (oligo.size() > MAX_PACKED_LENGTH)
+        return false;
+
+    packed = 0;
+    for (char c : oligo)
+    {
+        uint64_t code;
+        switch (c)
+        {
+        case 'A': code = 0; break;
+        case 'C': code = 1; break;
+        case 'G': code = 2; break;
+        case 'T': code = 3; break;
+        default: return false;
+        }
+        packed = (packed << 2) | code;
+    }
+
+    return true;
+}
+
+constexpr uint64_t lowMask(size_t bits)
+{
+    return bits >= 64 ? ~uint64_t{ 0 } : (uint64_t{ 1 } << bits) - 1;
+}
+
+// Same result as Instance::bestMatch for o1 against every oligonucleotide in `others`:
+// the smallest shift i in [1, L) for which the suffix of o1 starting at i equals the
+// prefix of o2, or L when they do not overlap. The shifts have a compile-time trip count
+// and are walked from the longest to the shortest with a select instead of an early exit,
+// so the body has no data dependent branches and the loop over `others` vectorises.
+template <size_t L, typename Weight>
+inline void packedBestMatchRow(PackedOligo o1, const PackedOligo* others, size_t count, Weight* weights)
+{
+    static_assert(L >= 1 && L <= MAX_PACKED_LENGTH, "packed oligonucleotide too long");
+
+    for (size_t j = 0; j < count; ++j)
+    {
+        const PackedOligo o2 = others[j];
+        Weight best = static_cast<Weight>(L);
+        for (size_t i = L - 1; i >= 1; --i)
+        {
+            const uint64_t suffix = o1 & lowMask(2 * (L - i));
+            const uint64_t prefix = o2 >> (2 * i);
+            best = (suffix == prefix) ? static_cast<Weight>(i) : best;
+        }
+        weights[j] = best;
+    }
+}
+
+template <typename Weight>
+using PackedRowKernel = void (*)(PackedOligo, const PackedOligo*, size_t, Weight*);
+
+namespace detail
+{
+    template <typename Weight, size_t... Ls>
+    constexpr auto makePackedRowKernels(std::index_sequence<Ls...>)
+    {
+        return std::array<PackedRowKernel<Weight>, sizeof...(Ls)>{ &packedBestMatchRow<Ls + 1, Weight>... };
+    }
+}
+
+// Returns the row kernel specialised for oligonucleotides of length l, or nullptr when
+// l has no packed representation and the caller has to fall back to the string path.
+template <typename Weight>
+inline PackedRowKernel<Weight> packedRowKernel(size_t l)
+{
+    static constexpr auto kernels = detail::makePackedRowKernels<Weight>(std::make_index_sequence<MAX_PACKED_LENGTH>{});
+    if (l == 0 || l > MAX_PACKED_LENGTH)
+        return nullptr;
+
+    return kernels[l - 1];
+}
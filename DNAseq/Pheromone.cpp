@@ -0,0 +1,56 @@
+#include "Pheromone.h"
+
+#include <algorithm>
+
+void PheromoneMatrix::assign(size_t rows, size_t columns, float initial)
+{
+    rowCount = rows;
+    columnCount = columns;
+    decay = 1.f;
+    minimum = 0.f;
+    maximum = 0.f;
+    data.assign(rows * columns, initial);
+}
+
+void PheromoneMatrix::setBounds(float minimum, float maximum)
+{
+    renormalise();
+    this->minimum = minimum;
+    this->maximum = maximum;
+    for (float& stored : data)
+    {
+        stored = std::max(stored, minimum);
+        if (maximum > 0.f)
+            stored = std::min(stored, maximum);
+    }
+}
+
+float PheromoneMatrix::value(size_t i, size_t j) const
+{
+    return std::max(data[i * columnCount + j] * decay, minimum);
+}
+
+bool PheromoneMatrix::evaporate(float rate, float minimumScale)
+{
+    decay *= 1.f - rate;
+    if (decay >= minimumScale)
+        return false;
+
+    renormalise();
+    return true;
+}
+
+void PheromoneMatrix::deposit(size_t i, size_t j, float amount)
+{
+    float& stored = data[i * columnCount + j];
+    stored = std::max(stored, storedFloor()) + amount / decay;
+    if (maximum > 0.f)
+        stored = std::min(stored, maximum / decay);
+}
+
+void PheromoneMatrix::renormalise()
+{
+    for (float& stored : data)
+        stored = std::max(stored * decay, minimum);
+    decay = 1.f;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Pheromone trails in one row-major buffer. Evaporation only multiplies a global
+// decay factor: entries are stored in units of that factor, so an iteration costs
+// nothing for the trails no ant walked, and the factor is folded back into the
+// buffer before the stored values grow out of a safe float range.
+class PheromoneMatrix
+{
+public:
+    // unbounded until setBounds, the buffer is reused when large enough
+    void assign(size_t rows, size_t columns, float initial);
+
+    // MAX-MIN bounds on the actual trail values, 0 disables a bound
+    void setBounds(float minimum, float maximum);
+    bool bounded() const { return minimum > 0.f || maximum > 0.f; }
+
+    size_t rows() const { return rowCount; }
+    size_t columns() const { return columnCount; }
+
+    // actual trail value
+    float value(size_t i, size_t j) const;
+
+    // Stored values are actual values divided by scale(). As scale() is common to
+    // every entry, ratios between stored values (floored at storedFloor()) are ratios
+    // between trails.
+    const float* storedRow(size_t i) const { return data.data() + i * columnCount; }
+    float stored(size_t i, size_t j) const { return data[i * columnCount + j]; }
+    float scale() const { return decay; }
+    float storedFloor() const { return minimum / decay; }
+
+    // Evaporates every trail by `rate` in O(1). Once scale() drops below minimumScale
+    // the buffer is renormalised and true is returned, i.e. every stored value changed.
+    bool evaporate(float rate, float minimumScale);
+    void deposit(size_t i, size_t j, float amount);
+
+private:
+    void renormalise();
+
+    size_t rowCount = 0;
+    size_t columnCount = 0;
+    float decay = 1.f;
+    float minimum = 0.f;
+    float maximum = 0.f;
+    std::vector<float> data;
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+
+// Counter-based generator: the n-th number of a stream is a pure function of
+// (seed, stream, n), so every thread can own a stream and a run is reproducible
+// from one seed no matter how the threads are scheduled.
+class CounterRng
+{
+public:
+    CounterRng(uint64_t seed = 0, uint64_t stream = 0)
+        : key{ mix(seed ^ mix(stream + 0x632BE59BD9B4E019ull)) } {}
+
+    uint64_t nextUInt64()
+    {
+        return mix(key + ++counter * 0x9E3779B97F4A7C15ull);
+    }
+
+    // uniform in [0, 1)
+    float nextFloat()
+    {
+        return static_cast<float>(nextUInt64() >> 40) * (1.f / 16777216.f);
+    }
+
+    // uniform in [0, bound)
+    uint64_t nextBelow(uint64_t bound)
+    {
+        return bound == 0 ? 0 : nextUInt64() % bound;
+    }
+
+    static uint64_t mix(uint64_t x)
+    {
+        // splitmix64 finaliser
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+private:
+    uint64_t key;
+    uint64_t counter = 0;
+};
@@ -0,0 +1,270 @@
+#include "Sequencer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#include "BoundedQueue.h"
+#include "IslandColony.h"
+#include "LocalSearch.h"
+#include "Logger.h"
+
+namespace
+{
+    // a seed path deposits as much pheromone as this many ants walking it
+    constexpr float SEED_WEIGHT = 10.f;
+
+    // the instance the solvers see, expand() their solution with it
+    const Instance& prepare(const Instance& original, const SequencerOptions& options, std::optional<Instance>& compacted)
+    {
+        if (!options.compact)
+            return original;
+
+        compacted.emplace(original.compacted());
+        LOG_INFO("compacted {} oligonucleotides into {} vertices", original.oligonucleotides.size(),
+            compacted->oligonucleotides.size());
+        return *compacted;
+    }
+
+    // the longest prefix of `path` that fits in instance.n
+    std::vector<int> fittingPrefix(const Instance& instance, const std::vector<size_t>& path)
+    {
+        std::vector<int> prefix;
+        size_t length = 0;
+        for (size_t i = 0; i < path.size(); ++i)
+        {
+            length += i == 0 ? instance.startLength(path[0]) : instance.adjMatrix(path[i - 1], path[i]);
+            if (length > instance.n)
+                break;
+            prefix.push_back(static_cast<int>(path[i]));
+        }
+        return prefix;
+    }
+
+    // the islands run at once, so the pool is made big enough for them up front
+    // instead of IslandColony making one of its own on every run
+    size_t poolSize(size_t numThreads, const SequencerOptions& options)
+    {
+        if (options.islands <= 1)
+            return numThreads;
+        if (numThreads == 0)
+            numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        return std::max(numThreads, options.islands);
+    }
+
+    std::vector<int> beamSeed(const Instance& instance, const SequencerOptions& options, const StopCondition& stop)
+    {
+        std::vector<size_t> path = BeamSearch{ instance, options.beamWidth }.run(stop);
+        LOG_INFO("beam seed: {} oligonucleotides", instance.countOligonucleotides(path));
+        return std::vector<int>{ path.begin(), path.end() };
+    }
+}
+
+std::unique_ptr<Sequencer> createSequencer(size_t numThreads, uint64_t seed, const SequencerOptions& options)
+{
+    if (options.solver == SequencerOptions::BEAM)
+        return std::make_unique<Beam_Sequencer>(options);
+    return std::make_unique<Our_Sequencer>(numThreads, seed, options);
+}
+
+Our_Sequencer::Our_Sequencer(size_t numThreads, uint64_t seed, const SequencerOptions& options)
+    : threadPool{ poolSize(numThreads, options) }, seed{ seed }, options{ options },
+      colonyBuffers(std::max<size_t>(options.islands, 1)), searchScratch(std::max<size_t>(options.searchThreads, 1))
+{
+    if (options.pipelined && options.islands > 1)
+        LOG_WARN("islands run without the pipelined local search, it needs a single colony");
+}
+
+size_t Our_Sequencer::run(const Instance& original, const StopCondition& stop, SolverMetrics* metrics)
+{
+    if (!original.hasAdjMatrix())
+        throw std::invalid_argument{ "the ant colony needs the dense overlap matrix, see InstanceOptions::denseMatrix" };
+
+    // the solvers see the compacted instance, the solution is expanded at the end
+    std::optional<Instance> compacted;
+    const Instance& instance = prepare(original, options, compacted);
+    std::vector<std::vector<int>> seedPaths;
+    if (options.beamSeed)
+        seedPaths.push_back(beamSeed(instance, options, stop));
+
+    // a run on the same instance after it was edited starts from the last solution,
+    // carried over the edits; the indices of a compacted instance change every time
+    if (original.serial() == previousInstance && original.revision() > previousRevision && !options.compact)
+    {
+        seedPaths.push_back(fittingPrefix(original, original.remap(solution, previousRevision)));
+        LOG_INFO("carried {} of {} oligonucleotides over {} edits", seedPaths.back().size(), solution.size(),
+            original.revision() - previousRevision);
+    }
+
+    // use AntColony and LocalSearch, with a deadline the colony gets 80% of the budget
+    StopCondition colonyStop = stop;
+    if (stop.hasDeadline())
+    {
+        auto now = StopCondition::Clock::now();
+        colonyStop = stop.sooner(now + (stop.getDeadline() - now) * 4 / 5);
+    }
+
+    AntColony::Parameters parameters(300, 200, 1.0f, 1.0f, 0.7f);
+    parameters.Seed = seed++;
+    parameters.StagnationIterations = (int)options.colonyStagnation;
+    Solution improvedResult;
+    if (options.pipelined && options.islands <= 1)
+    {
+        improvedResult = runPipelined(instance, stop, colonyStop, parameters, seedPaths, metrics);
+    }
+    else
+    {
+        std::vector<int> result;
+        if (options.islands > 1)
+        {
+            parameters.Ants = std::max<int>(parameters.Ants / (int)options.islands, 1);
+            IslandColony::Parameters islandParameters;
+            islandParameters.Islands = (int)options.islands;
+            IslandColony colony(instance, parameters, islandParameters, &threadPool, colonyBuffers.data());
+            colony.SetMetrics(metrics);
+            for (const std::vector<int>& seedPath : seedPaths)
+                colony.Reinforce(seedPath, SEED_WEIGHT);
+            result = colony.Run(colonyStop);
+        }
+        else
+        {
+            AntColony antColony(instance, parameters, &threadPool, &colonyBuffers[0]);
+            antColony.SetMetrics(metrics);
+            for (const std::vector<int>& seedPath : seedPaths)
+                antColony.Reinforce(seedPath, SEED_WEIGHT);
+            result = antColony.Run(colonyStop);
+        }
+
+        Solution lsInput = Solution{ result.begin(), result.end() };
+        LocalSearch localSearch(instance, lsInput, false, LocalSearch::TabuMode::SOLUTIONS, &threadPool,
+            &searchScratch[0]);
+        localSearch.setMetrics(metrics);
+        improvedResult = localSearch.run(30, 100, 2, stop, options.searchStagnation);
+    }
+
+    solution = instance.expand(improvedResult);
+    previousInstance = original.serial();
+    previousRevision = original.revision();
+
+    LOG_TRACE("sequence: {}", original.output(solution));
+    LOG_INFO("length: {}/{}", original.outputLength(solution), original.n);
+
+    return solution.size();
+}
+
+Solution Our_Sequencer::runPipelined(const Instance& instance, const StopCondition& stop,
+    const StopCondition& colonyStop, const AntColony::Parameters& parameters, const std::vector<std::vector<int>>& seedPaths,
+    SolverMetrics* metrics)
+{
+    // One slot where the colony's latest path replaces one no searcher took yet, so
+    // after the colony ends only the searches under way delay its final path.
+    BoundedQueue<std::vector<int>> paths{ 1 };
+    BoundedQueue<std::vector<int>> improvedPaths{ 4 };
+
+    std::mutex bestMutex;
+    RankedSolution best{ {}, 0, 0 };
+    std::exception_ptr error;
+    std::atomic<bool> failed{ false };
+
+    auto search = [&](LocalSearch::Scratch* scratch) {
+        while (std::optional<std::vector<int>> path = paths.pop())
+        {
+            // once stopped or failed, only drain the slot until it is closed
+            if (path->empty() || failed || stop.stopRequested())
+                continue;
+
+            try
+            {
+                LocalSearch localSearch(instance, Solution{ path->begin(), path->end() }, false,
+                    LocalSearch::TabuMode::SOLUTIONS, nullptr, scratch);
+                localSearch.setMetrics(metrics);
+                Solution improved = localSearch.run(30, 100, 2, stop, options.searchStagnation);
+
+                RankedSolution ranked{ improved, cost(improved, &instance), instance.countOligonucleotides(improved) };
+                {
+                    std::lock_guard<std::mutex> lock{ bestMutex };
+                    if (ranked > best)
+                        best = std::move(ranked);
+                }
+                if (options.feedback && ranked.oligonucleotides > instance.countOligonucleotides(*path))
+                    improvedPaths.tryPush(std::vector<int>{ improved.begin(), improved.end() });
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock{ bestMutex };
+                if (!error)
+                    error = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> searchers;
+    for (LocalSearch::Scratch& scratch : searchScratch)
+        searchers.emplace_back(search, &scratch);
+
+    AntColony antColony(instance, parameters, &threadPool, &colonyBuffers[0]);
+    antColony.SetMetrics(metrics);
+    for (const std::vector<int>& seedPath : seedPaths)
+        antColony.Reinforce(seedPath, SEED_WEIGHT);
+    size_t published = 0;
+    std::vector<int> colonyBest;
+    try
+    {
+        while (antColony.Step(colonyStop))
+        {
+            while (std::optional<std::vector<int>> improved = improvedPaths.tryPop())
+                antColony.Reinforce(*improved, 1.f);
+
+            if (instance.countOligonucleotides(antColony.BestPath()) > published)
+            {
+                published = instance.countOligonucleotides(antColony.BestPath());
+                paths.pushLatest(antColony.BestPath());
+            }
+        }
+
+        // the pheromone walk may still beat every ant
+        colonyBest = antColony.Best();
+        if (instance.countOligonucleotides(colonyBest) > published)
+            paths.pushLatest(colonyBest);
+    }
+    catch (...)
+    {
+        paths.close();
+        for (std::thread& searcher : searchers)
+            searcher.join();
+        throw;
+    }
+
+    paths.close();
+    for (std::thread& searcher : searchers)
+        searcher.join();
+    if (error)
+        std::rethrow_exception(error);
+
+    // the search may not have had time for any path
+    if (best.oligonucleotides < instance.countOligonucleotides(colonyBest))
+        return Solution{ colonyBest.begin(), colonyBest.end() };
+    return best.solution;
+}
+
+Beam_Sequencer::Beam_Sequencer(const SequencerOptions& options) : options{ options }
+{
+}
+
+size_t Beam_Sequencer::run(const Instance& original, const StopCondition& stop, SolverMetrics*)
+{
+    std::optional<Instance> compacted;
+    const Instance& instance = prepare(original, options, compacted);
+
+    solution = instance.expand(BeamSearch{ instance, options.beamWidth }.run(stop));
+
+    LOG_TRACE("sequence: {}", original.output(solution));
+    LOG_INFO("length: {}/{}", original.outputLength(solution), original.n);
+
+    return solution.size();
+}
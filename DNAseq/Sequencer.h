@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AntColony.h"
+#include "BeamSearch.h"
+#include "Instance.h"
+#include "LocalSearch.h"
+#include "Metrics.h"
+#include "StopCondition.h"
+#include "ThreadPool.h"
+
+class Sequencer
+{
+public:
+    virtual ~Sequencer() {};
+    // returns number of oligonucleotides used, stops early with the best solution so far on `stop`,
+    // counts the solvers' work into `metrics` when given
+    virtual size_t run(const Instance& instance, const StopCondition& stop = StopCondition{},
+        SolverMetrics* metrics = nullptr) = 0;
+    virtual std::string getName() const = 0;
+
+    // oligonucleotide indices of the solution found by the last run()
+    const std::vector<size_t>& getSolution() const { return solution; }
+
+protected:
+    std::vector<size_t> solution;
+};
+
+struct SequencerOptions
+{
+    enum Solver
+    {
+        COLONY, // Our_Sequencer
+        BEAM // Beam_Sequencer, milliseconds instead of seconds
+    };
+
+    Solver solver = COLONY;
+    size_t islands = 1; // > 1 splits the ants over that many IslandColony islands
+    // Local search runs on searchThreads threads of its own while a single colony goes
+    // on, on every longer path the colony finds, instead of after the colony.
+    bool pipelined = false;
+    size_t searchThreads = 1;
+    bool feedback = false; // pipelined: paths the search made longer reinforce the colony
+    bool compact = false; // solve Instance::compacted() and expand the solution
+    size_t beamWidth = BeamSearch::DEFAULT_WIDTH;
+    bool beamSeed = false; // COLONY: reinforce the colony with a BeamSearch path before the first ant
+    size_t colonyStagnation = 50; // colony iterations without a longer path before it stops, 0 = never
+    size_t searchStagnation = 30; // local search steps without improvement before it stops, 0 = never
+};
+
+// AntColony followed by LocalSearch. Running again on the same Instance after it was
+// edited reinforces the colony with the previous solution, carried over the edits.
+class Our_Sequencer : public Sequencer
+{
+public:
+    // numThreads as for ThreadPool, at least options.islands with islands; every run()
+    // is seeded with the next seed
+    explicit Our_Sequencer(size_t numThreads = 0, uint64_t seed = 0, const SequencerOptions& options = {});
+
+    virtual size_t run(const Instance& instance, const StopCondition& stop = StopCondition{},
+        SolverMetrics* metrics = nullptr) override;
+
+    virtual std::string getName() const override
+    {
+        return "Our Sequencer";
+    }
+
+private:
+    std::vector<size_t> runPipelined(const Instance& instance, const StopCondition& stop,
+        const StopCondition& colonyStop, const AntColony::Parameters& parameters, const std::vector<std::vector<int>>& seedPaths,
+        SolverMetrics* metrics);
+
+    ThreadPool threadPool; // shared by both stages, only the colony's when pipelined
+    uint64_t seed;
+    SequencerOptions options;
+    // storage kept from one run to the next: one colony's per island, one search's per
+    // search thread
+    std::vector<AntColony::Buffers> colonyBuffers;
+    std::vector<LocalSearch::Scratch> searchScratch;
+    // what the last solution was found on, to carry it over Instance edits
+    uint64_t previousInstance = 0; // Instance::serial()
+    size_t previousRevision = 0;
+};
+
+// BeamSearch alone, for answers that cannot wait for the colony
+class Beam_Sequencer : public Sequencer
+{
+public:
+    explicit Beam_Sequencer(const SequencerOptions& options = {});
+
+    virtual size_t run(const Instance& instance, const StopCondition& stop = StopCondition{},
+        SolverMetrics* metrics = nullptr) override;
+
+    virtual std::string getName() const override
+    {
+        return "Beam Sequencer";
+    }
+
+private:
+    SequencerOptions options;
+};
+
+// the sequencer options.solver names
+std::unique_ptr<Sequencer> createSequencer(size_t numThreads, uint64_t seed, const SequencerOptions& options);
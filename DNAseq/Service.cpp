@@ -0,0 +1,322 @@
+#include "Service.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <istream>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "Distributed.h"
+#include "Logger.h"
+
+// Requests are read on one thread, replies are sent from the solver threads one
+// at a time.
+class Service::Channel
+{
+public:
+    virtual ~Channel() = default;
+
+    // throw std::runtime_error once the client is gone
+    virtual std::string readLine() = 0;
+    virtual std::string read(size_t size) = 0;
+
+    void reply(const std::string& message)
+    {
+        std::lock_guard<std::mutex> lock{ sendMutex };
+        try
+        {
+            send(message);
+        }
+        catch (const std::exception& e)
+        {
+            LOG_WARN("client lost before its reply: {}", e.what());
+        }
+    }
+
+protected:
+    virtual void send(const std::string& message) = 0;
+
+private:
+    std::mutex sendMutex;
+};
+
+namespace
+{
+    class StreamChannel : public Service::Channel
+    {
+    public:
+        StreamChannel(std::istream& input, std::ostream& output) : input{ input }, output{ output } {}
+
+        std::string readLine() override
+        {
+            std::string line;
+            if (!std::getline(input, line))
+                throw std::runtime_error{ "end of input" };
+            return line;
+        }
+
+        std::string read(size_t size) override
+        {
+            std::string data(size, '\0');
+            if (!input.read(data.data(), static_cast<std::streamsize>(size)))
+                throw std::runtime_error{ "end of input" };
+            return data;
+        }
+
+    protected:
+        void send(const std::string& message) override
+        {
+            if (!output.write(message.data(), static_cast<std::streamsize>(message.size())).flush())
+                throw std::runtime_error{ "output closed" };
+        }
+
+    private:
+        std::istream& input;
+        std::ostream& output;
+    };
+
+    class SocketChannel : public Service::Channel
+    {
+    public:
+        explicit SocketChannel(Socket socket) : socket{ std::move(socket) } {}
+
+        std::string readLine() override { return socket.readLine(); }
+        std::string read(size_t size) override { return socket.read(size); }
+
+        // the reading thread fails out of its read, the socket closes with the last reference
+        void disconnect() { socket.shutdown(); }
+
+    protected:
+        void send(const std::string& message) override { socket.send(message); }
+
+    private:
+        Socket socket;
+    };
+
+    // `path` resolved against `root`, or nothing if it leaves the root once links and
+    // .. are followed or there is no root
+    std::optional<std::filesystem::path> resolveFile(const std::filesystem::path& root, const std::string& path)
+    {
+        if (root.empty() || path.empty())
+            return std::nullopt;
+
+        std::error_code error;
+        const std::filesystem::path base = std::filesystem::weakly_canonical(root, error);
+        if (error)
+            return std::nullopt;
+        const std::filesystem::path file = std::filesystem::weakly_canonical(base / path, error);
+        if (error)
+            return std::nullopt;
+
+        const std::filesystem::path relative = file.lexically_relative(base);
+        if (relative.empty() || *relative.begin() == "..")
+            return std::nullopt;
+        return file;
+    }
+}
+
+Service::Service(SequencerFactory makeSequencer, const ServiceOptions& options)
+    : makeSequencer{ std::move(makeSequencer) }, options{ options }, jobs{ options.queueCapacity }
+{
+    const size_t count = options.solvers > 0 ? options.solvers : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        solvers.emplace_back([this] {
+            // one sequencer, with its threads and buffers, for every request this solver takes
+            std::unique_ptr<Sequencer> sequencer;
+            std::string error;
+            try
+            {
+                sequencer = this->makeSequencer();
+            }
+            catch (const std::exception& e)
+            {
+                LOG_ERROR("cannot create a sequencer: {}", e.what());
+                error = e.what();
+            }
+
+            while (std::optional<Job> job = jobs.pop())
+            {
+                if (sequencer)
+                {
+                    solve(*sequencer, *job);
+                    continue;
+                }
+
+                BatchResult result;
+                result.name = job->name;
+                result.error = error;
+                job->channel->reply(encodeReply(result));
+            }
+        });
+    }
+}
+
+Service::~Service()
+{
+    finish();
+}
+
+void Service::serve(std::istream& input, std::ostream& output)
+{
+    readRequests(std::make_shared<StreamChannel>(input, output));
+    stopping = true;
+    finish();
+}
+
+void Service::serve(Socket& listener)
+{
+    struct Client
+    {
+        std::shared_ptr<SocketChannel> channel;
+        std::thread reader;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+
+    std::list<Client> clients;
+    while (!stopping)
+    {
+        clients.remove_if([](Client& client) {
+            if (!*client.done)
+                return false;
+            client.reader.join();
+            return true;
+        });
+
+        Socket connection = listener.accept(100);
+        if (!connection)
+            continue;
+
+        auto channel = std::make_shared<SocketChannel>(std::move(connection));
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        std::thread reader{ [this, channel, done] {
+            readRequests(channel);
+            *done = true;
+        } };
+        clients.push_back(Client{ std::move(channel), std::move(reader), std::move(done) });
+    }
+
+    LOG_INFO("shutting down, {} requests queued", jobs.size());
+    finish();
+    for (Client& client : clients)
+    {
+        client.channel->disconnect();
+        client.reader.join();
+    }
+}
+
+void Service::readRequests(const std::shared_ptr<Channel>& channel)
+{
+    try
+    {
+        while (!stopping)
+        {
+            std::istringstream request{ channel->readLine() };
+            std::string kind;
+            request >> kind;
+            if (kind.empty())
+                continue;
+            if (kind == "QUIT")
+                return;
+            if (kind == "SHUTDOWN")
+            {
+                stopping = true;
+                return;
+            }
+
+            Job job;
+            job.channel = channel;
+            long long budget = 0;
+            if (kind == "SOLVE")
+            {
+                size_t size = 0;
+                if (!(request >> budget >> size))
+                    throw std::runtime_error{ "malformed SOLVE" };
+                std::getline(request >> std::ws, job.name);
+                if (size > options.maxSpectrumBytes)
+                {
+                    BatchResult result;
+                    result.name = job.name;
+                    result.error = "spectrum of " + std::to_string(size) + " bytes, at most "
+                        + std::to_string(options.maxSpectrumBytes) + " are accepted";
+                    channel->reply(encodeReply(result));
+                    throw std::runtime_error{ result.error };
+                }
+                job.spectrum = channel->read(size);
+            }
+            else if (kind == "FILE")
+            {
+                if (!(request >> budget))
+                    throw std::runtime_error{ "malformed FILE" };
+                std::getline(request >> std::ws, job.name);
+                const std::optional<std::filesystem::path> file = resolveFile(options.fileRoot, job.name);
+                if (!file)
+                {
+                    BatchResult result;
+                    result.name = job.name;
+                    result.error = options.fileRoot.empty() ? "FILE requests are not accepted"
+                        : "not a file under " + options.fileRoot.string();
+                    channel->reply(encodeReply(result));
+                    continue;
+                }
+                job.path = file->string();
+            }
+            else
+            {
+                throw std::runtime_error{ "unexpected request " + kind };
+            }
+            job.budget = std::chrono::milliseconds{ budget };
+
+            // never wait for room, the client decides whether to retry
+            const std::string name = job.name;
+            if (!jobs.tryPush(std::move(job)))
+            {
+                if (stopping)
+                {
+                    BatchResult result;
+                    result.name = name;
+                    result.error = "the service is shutting down";
+                    channel->reply(encodeReply(result));
+                }
+                else
+                {
+                    channel->reply("BUSY " + name + '\n');
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // the client is gone or out of step, nothing more can be read from it
+        if (!stopping)
+            LOG_INFO("client done: {}", e.what());
+    }
+}
+
+void Service::solve(Sequencer& sequencer, Job& job)
+{
+    auto load = [&] {
+        if (!job.path.empty())
+            return Instance{ std::filesystem::path{ job.path }, options.instanceOptions };
+        return Instance{ job.name, job.spectrum, options.instanceOptions };
+    };
+    const std::chrono::milliseconds budget = job.budget.count() > 0 ? job.budget : options.budget;
+    BatchResult result = solveInstance(job.name, load, sequencer, budget);
+    // the instance of a FILE is named after the file alone, the reply after the request
+    result.name = job.name;
+    job.channel->reply(encodeReply(result));
+}
+
+void Service::finish()
+{
+    jobs.close();
+    for (std::thread& solver : solvers)
+    {
+        if (solver.joinable())
+            solver.join();
+    }
+}
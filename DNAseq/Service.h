@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Batch.h"
+#include "BoundedQueue.h"
+#include "Distributed.h"
+#include "Socket.h"
+
+struct ServiceOptions
+{
+    size_t solvers = 0; // requests solved at once, 0 = one per hardware thread
+    size_t queueCapacity = 16; // requests waiting for a solver before new ones are turned away
+    std::chrono::milliseconds budget{ 0 }; // for requests that give none, 0 = no limit
+    size_t maxSpectrumBytes = MAX_SPECTRUM_BYTES; // larger SOLVE spectra are refused
+    std::filesystem::path fileRoot; // FILE paths are taken relative to it, empty = FILE refused
+    InstanceOptions instanceOptions;
+};
+
+// A long-running solver. Requests from any number of clients wait in one bounded
+// queue for a fixed set of solver threads, each of which keeps its sequencer, and
+// so the sequencer's thread pool, from one request to the next. The protocol is
+// the one of Distributed.h with a few more requests:
+//
+//   client:  SOLVE <budget ms> <bytes> <name>\n<spectrum>   oligonucleotides inline
+//            FILE <budget ms> <path>\n                      a spectrum file under ServiceOptions::fileRoot
+//            QUIT\n                                         closes this client's connection
+//            SHUTDOWN\n                                     stops the service
+//   service: RESULT or ERROR as in Distributed.h, once the request is solved
+//            BUSY <name>\n right away when the queue is full
+//
+// A budget of 0 stands for ServiceOptions::budget. Replies come in the order the
+// requests finish, the name tells them apart; for FILE the name is the path as sent.
+// A SOLVE over ServiceOptions::maxSpectrumBytes gets an ERROR and the client is
+// disconnected, as its spectrum is not read. A FILE whose path, with links and ..
+// resolved, is not inside fileRoot gets an ERROR, as does every FILE without a root.
+class Service
+{
+public:
+    Service(SequencerFactory makeSequencer, const ServiceOptions& options = {});
+    // answers every queued request first
+    ~Service();
+
+    Service(const Service&) = delete;
+    Service& operator=(const Service&) = delete;
+
+    // Serves the requests read from `input`, replying on `output`, until the input
+    // ends or asks for SHUTDOWN. Returns once every request was answered.
+    void serve(std::istream& input, std::ostream& output);
+    // Serves every client connecting to `listener` until one asks for SHUTDOWN, then
+    // answers the queued requests and disconnects the clients.
+    void serve(Socket& listener);
+
+    class Channel; // one client, see Service.cpp
+
+private:
+    struct Job
+    {
+        std::shared_ptr<Channel> channel; // where the reply goes
+        std::string name;
+        std::string spectrum; // SOLVE
+        std::string path; // FILE
+        std::chrono::milliseconds budget{ 0 };
+    };
+
+    void readRequests(const std::shared_ptr<Channel>& channel);
+    void solve(Sequencer& sequencer, Job& job);
+    void finish(); // closes the queue and waits for the solvers
+
+    const SequencerFactory makeSequencer;
+    const ServiceOptions options;
+    BoundedQueue<Job> jobs;
+    std::vector<std::thread> solvers;
+    std::atomic<bool> stopping{ false };
+};
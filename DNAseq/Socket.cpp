@@ -0,0 +1,328 @@
+#include "Socket.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef _WIN32
+    using Length = int;
+
+    void startup()
+    {
+        struct Winsock
+        {
+            Winsock()
+            {
+                WSADATA data;
+                if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+                    throw std::runtime_error{ "cannot start Winsock" };
+            }
+            ~Winsock() { WSACleanup(); }
+        };
+        static Winsock winsock;
+    }
+
+    void closeHandle(uintptr_t handle) { closesocket(static_cast<SOCKET>(handle)); }
+    int pollOne(pollfd* descriptor, int timeout) { return WSAPoll(descriptor, 1, timeout); }
+    bool timedOut() { return WSAGetLastError() == WSAETIMEDOUT; }
+#else
+    using Length = size_t;
+
+    void startup() {}
+    void closeHandle(int handle) { ::close(handle); }
+    int pollOne(pollfd* descriptor, int timeout) { return poll(descriptor, 1, timeout); }
+    bool timedOut() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+#endif
+
+#ifdef MSG_NOSIGNAL
+    constexpr int SEND_FLAGS = MSG_NOSIGNAL; // a closed peer is an error, not SIGPIPE
+#else
+    constexpr int SEND_FLAGS = 0;
+#endif
+
+    constexpr std::string_view UNIX_PREFIX = "unix:";
+    constexpr size_t READ_SIZE = 64 * 1024;
+
+    enum class PathKind
+    {
+        MISSING,
+        SOCKET,
+        OTHER
+    };
+
+    // what is at a Unix domain socket path, without following a symbolic link
+    PathKind pathKind(const char* path)
+    {
+#ifdef _WIN32
+        // AF_UNIX sockets are reparse points on Windows
+        const DWORD attributes = GetFileAttributesA(path);
+        if (attributes == INVALID_FILE_ATTRIBUTES)
+            return PathKind::MISSING;
+        return attributes & FILE_ATTRIBUTE_REPARSE_POINT ? PathKind::SOCKET : PathKind::OTHER;
+#else
+        struct stat status;
+        if (lstat(path, &status) != 0)
+            return PathKind::MISSING;
+        return S_ISSOCK(status.st_mode) ? PathKind::SOCKET : PathKind::OTHER;
+#endif
+    }
+
+    bool isUnix(const std::string& address)
+    {
+        return address.compare(0, UNIX_PREFIX.size(), UNIX_PREFIX) == 0;
+    }
+
+    sockaddr_un unixAddress(const std::string& address)
+    {
+        sockaddr_un result{};
+        result.sun_family = AF_UNIX;
+        const std::string path = address.substr(UNIX_PREFIX.size());
+        if (path.empty() || path.size() >= sizeof(result.sun_path))
+            throw std::runtime_error{ "invalid socket path " + path };
+        std::memcpy(result.sun_path, path.c_str(), path.size() + 1);
+        return result;
+    }
+
+    // every TCP address HOST:PORT resolves to, HOST may be empty to listen on all interfaces
+    addrinfo* resolve(const std::string& address, bool passive)
+    {
+        const size_t colon = address.rfind(':');
+        if (colon == std::string::npos)
+            throw std::runtime_error{ "invalid address " + address };
+        const std::string host = address.substr(0, colon);
+        const std::string port = address.substr(colon + 1);
+
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = passive ? AI_PASSIVE : 0;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses) != 0)
+            throw std::runtime_error{ "cannot resolve " + address };
+        return addresses;
+    }
+}
+
+Socket::~Socket()
+{
+    close();
+}
+
+Socket::Socket(Socket&& other) noexcept
+    : handle{ std::exchange(other.handle, INVALID) }, buffer{ std::move(other.buffer) },
+      bufferStart{ std::exchange(other.bufferStart, 0) }, unixPath{ std::move(other.unixPath) }
+{
+    other.unixPath.clear();
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        handle = std::exchange(other.handle, INVALID);
+        buffer = std::move(other.buffer);
+        bufferStart = std::exchange(other.bufferStart, 0);
+        unixPath = std::move(other.unixPath);
+        other.unixPath.clear();
+    }
+    return *this;
+}
+
+Socket Socket::listen(const std::string& address)
+{
+    startup();
+    if (isUnix(address))
+    {
+        sockaddr_un local = unixAddress(address);
+        Socket socket{ static_cast<Handle>(::socket(AF_UNIX, SOCK_STREAM, 0)) };
+        if (!socket)
+            throw std::runtime_error{ "cannot create a socket for " + address };
+
+        // only a socket left behind is replaced, a mistyped address must not delete a file
+        const PathKind existing = pathKind(local.sun_path);
+        if (existing == PathKind::OTHER)
+            throw std::runtime_error{ "cannot listen on " + address + ", the path is not a socket" };
+        if (existing == PathKind::SOCKET)
+            std::remove(local.sun_path);
+        if (::bind(socket.handle, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0
+            || ::listen(socket.handle, SOMAXCONN) != 0)
+            throw std::runtime_error{ "cannot listen on " + address };
+        socket.unixPath = local.sun_path;
+        return socket;
+    }
+
+    addrinfo* addresses = resolve(address, true);
+    for (addrinfo* candidate = addresses; candidate; candidate = candidate->ai_next)
+    {
+        Socket socket{ static_cast<Handle>(::socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol)) };
+        if (!socket)
+            continue;
+
+        int reuse = 1;
+        setsockopt(socket.handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+        if (::bind(socket.handle, candidate->ai_addr, static_cast<int>(candidate->ai_addrlen)) == 0
+            && ::listen(socket.handle, SOMAXCONN) == 0)
+        {
+            freeaddrinfo(addresses);
+            return socket;
+        }
+    }
+    freeaddrinfo(addresses);
+    throw std::runtime_error{ "cannot listen on " + address };
+}
+
+Socket Socket::connect(const std::string& address)
+{
+    startup();
+    if (isUnix(address))
+    {
+        sockaddr_un remote = unixAddress(address);
+        Socket socket{ static_cast<Handle>(::socket(AF_UNIX, SOCK_STREAM, 0)) };
+        if (!socket || ::connect(socket.handle, reinterpret_cast<sockaddr*>(&remote), sizeof(remote)) != 0)
+            throw std::runtime_error{ "cannot connect to " + address };
+        return socket;
+    }
+
+    addrinfo* addresses = resolve(address, false);
+    for (addrinfo* candidate = addresses; candidate; candidate = candidate->ai_next)
+    {
+        Socket socket{ static_cast<Handle>(::socket(candidate->ai_family, candidate->ai_socktype, candidate->ai_protocol)) };
+        if (socket && ::connect(socket.handle, candidate->ai_addr, static_cast<int>(candidate->ai_addrlen)) == 0)
+        {
+            freeaddrinfo(addresses);
+            return socket;
+        }
+    }
+    freeaddrinfo(addresses);
+    throw std::runtime_error{ "cannot connect to " + address };
+}
+
+Socket Socket::accept(int timeoutMilliseconds)
+{
+    pollfd descriptor{};
+    descriptor.fd = handle;
+    descriptor.events = POLLIN;
+    if (pollOne(&descriptor, timeoutMilliseconds) <= 0)
+        return Socket{};
+
+    return Socket{ static_cast<Handle>(::accept(handle, nullptr, nullptr)) };
+}
+
+void Socket::send(std::string_view data)
+{
+    while (!data.empty())
+    {
+        const auto sent = ::send(handle, data.data(), static_cast<Length>(data.size()), SEND_FLAGS);
+        if (sent <= 0)
+            throw std::runtime_error{ "connection lost" };
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+}
+
+std::string Socket::readLine()
+{
+    size_t end;
+    size_t searched = bufferStart; // no '\n' before this
+    while ((end = buffer.find('\n', searched)) == std::string::npos)
+    {
+        if (buffer.size() - bufferStart > MAX_LINE_LENGTH)
+            throw std::runtime_error{ "line longer than " + std::to_string(MAX_LINE_LENGTH) + " bytes" };
+        searched = buffer.size() - bufferStart;
+        fill();
+        searched += bufferStart;
+    }
+
+    std::string line = buffer.substr(bufferStart, end - bufferStart);
+    bufferStart = end + 1;
+    return line;
+}
+
+std::string Socket::read(size_t size)
+{
+    while (buffer.size() - bufferStart < size)
+        fill();
+
+    std::string data = buffer.substr(bufferStart, size);
+    bufferStart += size;
+    return data;
+}
+
+void Socket::setReceiveTimeout(int timeoutMilliseconds)
+{
+#ifdef _WIN32
+    DWORD timeout = static_cast<DWORD>(timeoutMilliseconds);
+#else
+    timeval timeout{};
+    timeout.tv_sec = timeoutMilliseconds / 1000;
+    timeout.tv_usec = (timeoutMilliseconds % 1000) * 1000;
+#endif
+    setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+
+    // not supported by Unix domain sockets, where the peer's host cannot go away
+    int keepAlive = 1;
+    setsockopt(handle, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char*>(&keepAlive), sizeof(keepAlive));
+}
+
+void Socket::fill()
+{
+    // drop what was consumed before growing the buffer
+    buffer.erase(0, bufferStart);
+    bufferStart = 0;
+
+    const size_t filled = buffer.size();
+    buffer.resize(filled + READ_SIZE);
+    const auto received = ::recv(handle, &buffer[filled], static_cast<Length>(READ_SIZE), 0);
+    const bool expired = received < 0 && timedOut();
+    buffer.resize(filled + (received > 0 ? static_cast<size_t>(received) : 0));
+    if (received <= 0)
+        throw std::runtime_error{ expired ? "receive timed out" : "connection lost" };
+}
+
+void Socket::shutdown()
+{
+    if (handle == INVALID)
+        return;
+
+#ifdef _WIN32
+    ::shutdown(handle, SD_BOTH);
+#else
+    ::shutdown(handle, SHUT_RDWR);
+#endif
+}
+
+void Socket::close()
+{
+    if (handle == INVALID)
+        return;
+
+    closeHandle(handle);
+    handle = INVALID;
+    if (!unixPath.empty())
+    {
+        if (pathKind(unixPath.c_str()) == PathKind::SOCKET)
+            std::remove(unixPath.c_str());
+        unixPath.clear();
+    }
+}
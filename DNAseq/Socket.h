@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// A connected or listening stream socket, closed on destruction. Addresses are
+// "unix:PATH" for a Unix domain socket or "HOST:PORT" for TCP. Reads are buffered
+// so a line protocol can mix lines and fixed-size payloads.
+class Socket
+{
+public:
+    Socket() = default;
+    ~Socket();
+
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket&& other) noexcept;
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    // throw std::runtime_error when the address cannot be used; a Unix domain
+    // socket left behind by an earlier listener is replaced, any other file there is
+    // left alone and makes listen throw
+    static Socket listen(const std::string& address);
+    static Socket connect(const std::string& address);
+
+    explicit operator bool() const { return handle != INVALID; }
+
+    // the next connection, or a closed socket if none arrived within timeoutMilliseconds
+    Socket accept(int timeoutMilliseconds);
+
+    // A peer that never ends its line must not make the buffer grow without bound;
+    // a reply line holds at most a whole sequence.
+    static constexpr size_t MAX_LINE_LENGTH = size_t{ 16 } << 20;
+
+    // throw std::runtime_error once the connection is closed or broken
+    void send(std::string_view data);
+    std::string readLine(); // without the '\n', throws past MAX_LINE_LENGTH
+    std::string read(size_t size); // a size read from the peer must be checked first
+
+    // Makes reads fail with std::runtime_error once nothing arrived for
+    // timeoutMilliseconds, 0 = wait forever. TCP keepalive probes are turned on too,
+    // so a peer whose host went down is noticed while waiting.
+    void setReceiveTimeout(int timeoutMilliseconds);
+
+    // stops both directions but keeps the handle, so a thread blocked reading it
+    // fails with std::runtime_error; close() stays with the owner
+    void shutdown();
+    void close();
+
+private:
+#ifdef _WIN32
+    using Handle = uintptr_t; // SOCKET
+    static constexpr Handle INVALID = ~Handle{ 0 };
+#else
+    using Handle = int;
+    static constexpr Handle INVALID = -1;
+#endif
+
+    explicit Socket(Handle handle) : handle{ handle } {}
+    void fill(); // reads what is available into the buffer
+
+    Handle handle = INVALID;
+    std::string buffer; // received, not yet consumed from bufferStart
+    size_t bufferStart = 0;
+    std::string unixPath; // removed when a listening Unix domain socket closes
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "OverlapMatrix.h"
+
+// Overlaps of at least some length as compressed rows: row i lists the successors j
+// that overlap i, best overlap (smallest weight) first and by index among equal
+// weights. Pairs that are not listed have weight l. Memory is O(s + overlaps), so
+// it fits spectra whose dense OverlapMatrix would not.
+class SparseOverlaps
+{
+public:
+    using Weight = OverlapMatrix::Weight;
+
+    void clear()
+    {
+        offsets.assign(1, 0);
+        targets.clear();
+        targetWeights.clear();
+    }
+
+    // appends j to the row being built, rows are built in order
+    void add(uint32_t j, Weight weight)
+    {
+        targets.push_back(j);
+        targetWeights.push_back(weight);
+    }
+
+    // ends the row being built
+    void finishRow() { offsets.push_back(targets.size()); }
+
+    bool empty() const { return size() == 0; }
+    size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    size_t edges() const { return targets.size(); }
+
+    size_t count(size_t i) const { return offsets[i + 1] - offsets[i]; }
+    const uint32_t* vertices(size_t i) const { return targets.data() + offsets[i]; }
+    const Weight* weights(size_t i) const { return targetWeights.data() + offsets[i]; }
+
+    // the weight of i -> j, `missing` when the row does not list j
+    Weight operator()(size_t i, size_t j, Weight missing) const
+    {
+        for (size_t e = offsets[i]; e < offsets[i + 1]; ++e)
+        {
+            if (targets[e] == j)
+                return targetWeights[e];
+        }
+        return missing;
+    }
+
+private:
+    std::vector<size_t> offsets; // row i in [offsets[i], offsets[i + 1])
+    std::vector<uint32_t> targets;
+    std::vector<Weight> targetWeights;
+};
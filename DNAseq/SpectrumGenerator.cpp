@@ -0,0 +1,159 @@
+#include "SpectrumGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Random.h"
+
+namespace
+{
+    constexpr char BASES[] = { 'A', 'C', 'G', 'T' };
+
+    // copies random l-mers over other positions until `errors` of the s windows
+    // repeat an earlier one; gives up on sequences too short to hold them
+    void injectRepeats(std::string& sequence, size_t l, size_t errors, CounterRng& random)
+    {
+        const size_t s = sequence.size() - l + 1;
+        std::unordered_map<std::string, size_t> counts; // occurrences of every l-mer
+        for (size_t p = 0; p < s; ++p)
+            ++counts[sequence.substr(p, l)];
+
+        for (size_t attempt = 0; s - counts.size() < errors && attempt < 100 * errors + 1000; ++attempt)
+        {
+            const size_t from = random.nextBelow(s);
+            const size_t to = random.nextBelow(s);
+            if (from == to)
+                continue;
+
+            // windows overlapping [to, to + l) change
+            const size_t first = to >= l - 1 ? to - (l - 1) : 0;
+            const size_t last = std::min(to + l - 1, s - 1);
+            for (size_t p = first; p <= last; ++p)
+            {
+                auto it = counts.find(sequence.substr(p, l));
+                if (--it->second == 0)
+                    counts.erase(it);
+            }
+
+            const std::string window = sequence.substr(from, l);
+            sequence.replace(to, l, window);
+
+            for (size_t p = first; p <= last; ++p)
+                ++counts[sequence.substr(p, l)];
+        }
+    }
+}
+
+GeneratedSpectrum generateSpectrum(const SpectrumOptions& options, size_t id)
+{
+    CounterRng random{ options.seed, id };
+    const size_t l = options.l;
+
+    GeneratedSpectrum result;
+    result.sequence = options.sequence;
+    if (result.sequence.empty())
+    {
+        result.sequence.resize(options.n);
+        for (char& base : result.sequence)
+            base = BASES[random.nextBelow(4)];
+    }
+
+    if (l < 2 || l > OverlapMatrix::MAX_WEIGHT)
+        throw std::invalid_argument{ "oligonucleotide length out of range" };
+    if (result.sequence.size() < l)
+        throw std::invalid_argument{ "sequence shorter than an oligonucleotide" };
+    if (options.errorRate < 0.0 || options.errorRate >= 1.0)
+        throw std::invalid_argument{ "error rate out of range" };
+
+    const size_t s = result.sequence.size() - l + 1;
+    const size_t errors = static_cast<size_t>(std::llround(options.errorRate * s));
+    const Instance::ErrorType type = errors > 0 ? options.errorType : Instance::NONE;
+
+    if (type == Instance::NEGATIVE_REPEAT)
+        injectRepeats(result.sequence, l, errors, random);
+
+    // distinct l-mers in order of their first occurrence
+    std::vector<std::string> oligonucleotides;
+    std::unordered_set<std::string> present;
+    oligonucleotides.reserve(s + errors);
+    present.reserve(s + errors);
+    for (size_t p = 0; p < s; ++p)
+    {
+        std::string oligonucleotide = result.sequence.substr(p, l);
+        if (present.insert(oligonucleotide).second)
+            oligonucleotides.push_back(std::move(oligonucleotide));
+    }
+
+    size_t added = 0;
+    if (type == Instance::NEGATIVE_RANDOM)
+    {
+        // keep at least one oligonucleotide
+        for (size_t removed = 0; removed < errors && oligonucleotides.size() > 1; ++removed)
+        {
+            std::swap(oligonucleotides[random.nextBelow(oligonucleotides.size())], oligonucleotides.back());
+            oligonucleotides.pop_back();
+        }
+    }
+    else if (type == Instance::POSITIVE_RANDOM || type == Instance::POSITIVE_WRONG_ENDING)
+    {
+        const size_t real = oligonucleotides.size();
+        for (size_t attempt = 0; added < errors && attempt < 100 * errors + 1000; ++attempt)
+        {
+            std::string oligonucleotide;
+            if (type == Instance::POSITIVE_RANDOM)
+            {
+                oligonucleotide.resize(l);
+                for (char& base : oligonucleotide)
+                    base = BASES[random.nextBelow(4)];
+            }
+            else
+            {
+                oligonucleotide = oligonucleotides[random.nextBelow(real)];
+                oligonucleotide.back() = BASES[random.nextBelow(4)];
+            }
+
+            if (present.insert(oligonucleotide).second)
+            {
+                oligonucleotides.push_back(std::move(oligonucleotide));
+                ++added;
+            }
+        }
+    }
+
+    for (size_t i = oligonucleotides.size(); i > 1; --i)
+        std::swap(oligonucleotides[i - 1], oligonucleotides[random.nextBelow(i)]);
+
+    result.spectrum.reserve(oligonucleotides.size() * (l + 1));
+    for (const std::string& oligonucleotide : oligonucleotides)
+    {
+        result.spectrum += oligonucleotide;
+        result.spectrum += '\n';
+    }
+
+    // repeats the sequence has by chance count as negative errors too
+    const bool positive = type == Instance::POSITIVE_RANDOM || type == Instance::POSITIVE_WRONG_ENDING;
+    const size_t numErrors = positive ? added : s - oligonucleotides.size();
+    result.name = std::to_string(id) + '.' + std::to_string(s) + (positive ? '+' : '-') + std::to_string(numErrors);
+    if (type != Instance::NONE && Instance::errorTypeOf(positive, numErrors) != type)
+        result.name += std::string{ '.' } + Instance::errorTypeTag(type);
+
+    return result;
+}
+
+void writeSpectrum(const GeneratedSpectrum& spectrum, const std::filesystem::path& directory)
+{
+    std::filesystem::create_directories(directory);
+
+    std::ofstream file{ directory / spectrum.name, std::ios::binary | std::ios::trunc };
+    file << spectrum.spectrum;
+    std::ofstream reference{ directory / (spectrum.name + REFERENCE_EXTENSION), std::ios::binary | std::ios::trunc };
+    reference << spectrum.sequence << '\n';
+
+    if (!file || !reference)
+        throw std::runtime_error{ "cannot write " + (directory / spectrum.name).string() };
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "Instance.h"
+
+// extension of the reference sequence written next to a generated spectrum, skip
+// it when scanning a directory of spectra
+inline constexpr const char* REFERENCE_EXTENSION = ".ref";
+
+struct SpectrumOptions
+{
+    size_t n = 500; // length of the random sequence
+    size_t l = 10; // oligonucleotide length
+    std::string sequence{}; // used instead of a random sequence when not empty
+    Instance::ErrorType errorType = Instance::NONE;
+    double errorRate = 0.0; // errors as a fraction of s
+    uint64_t seed = 0;
+};
+
+struct GeneratedSpectrum
+{
+    std::string name; // `<id>.<s>(+|-)<errors>[.<tag>]`, see Instance::errorTypeOf
+    std::string sequence; // the reference the spectrum was read from
+    std::string spectrum; // one oligonucleotide per line, shuffled
+};
+
+// The distinct l-mers of the sequence with errorRate * s errors of errorType:
+// NEGATIVE_RANDOM drops random oligonucleotides, NEGATIVE_REPEAT copies l-mers over
+// other places of the sequence until that many are repeats, POSITIVE_RANDOM adds
+// random l-mers and POSITIVE_WRONG_ENDING adds real ones with a changed last base.
+// The same options and id give the same spectrum. Throws std::invalid_argument on
+// impossible options.
+GeneratedSpectrum generateSpectrum(const SpectrumOptions& options, size_t id = 1);
+
+// writes <directory>/<name> and <directory>/<name>.ref
+void writeSpectrum(const GeneratedSpectrum& spectrum, const std::filesystem::path& directory);
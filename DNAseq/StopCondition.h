@@ -0,0 +1,45 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+// When a solver has to give up and return the best solution found so far: a
+// wall-clock deadline and/or a cancellation flag owned by the caller. The
+// default one never stops.
+class StopCondition
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StopCondition() = default;
+
+    explicit StopCondition(Clock::time_point deadline, const std::atomic<bool>* cancelled = nullptr)
+        : deadline{ deadline }, cancelled{ cancelled }
+    {
+    }
+
+    static StopCondition after(Clock::duration budget, const std::atomic<bool>* cancelled = nullptr)
+    {
+        return StopCondition{ Clock::now() + budget, cancelled };
+    }
+
+    bool hasDeadline() const { return deadline != Clock::time_point::max(); }
+    Clock::time_point getDeadline() const { return deadline; }
+
+    // the same condition with the deadline moved to `sooner` if that is sooner
+    StopCondition sooner(Clock::time_point sooner) const
+    {
+        return StopCondition{ std::min(deadline, sooner), cancelled };
+    }
+
+    bool stopRequested() const
+    {
+        if (cancelled && cancelled->load(std::memory_order_relaxed))
+            return true;
+        return hasDeadline() && Clock::now() >= deadline;
+    }
+
+private:
+    Clock::time_point deadline = Clock::time_point::max();
+    const std::atomic<bool>* cancelled = nullptr;
+};
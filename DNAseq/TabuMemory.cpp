@@ -0,0 +1,36 @@
+#include "TabuMemory.h"
+
+void TabuMemory::reset(size_t capacity)
+{
+    ring.assign(capacity, 0);
+    next = 0;
+    count = 0;
+    counts.clear();
+    counts.reserve(capacity);
+}
+
+void TabuMemory::push(uint64_t key)
+{
+    if (ring.empty())
+        return;
+
+    if (count == ring.size())
+    {
+        auto oldest = counts.find(ring[next]);
+        if (--oldest->second == 0)
+            counts.erase(oldest);
+    }
+    else
+    {
+        ++count;
+    }
+
+    ring[next] = key;
+    ++counts[key];
+    next = (next + 1) % ring.size();
+}
+
+bool TabuMemory::contains(uint64_t key) const
+{
+    return counts.find(key) != counts.end();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// The last `capacity` keys pushed, in a ring buffer with a count per key so a lookup
+// is O(1) and memory stays bounded however long the search runs.
+class TabuMemory
+{
+public:
+    // forgets every key; 0 keeps none
+    void reset(size_t capacity);
+
+    // the oldest key is dropped once the memory is full
+    void push(uint64_t key);
+    bool contains(uint64_t key) const;
+
+private:
+    std::vector<uint64_t> ring;
+    size_t next = 0;
+    size_t count = 0;
+    std::unordered_map<uint64_t, size_t> counts;
+};
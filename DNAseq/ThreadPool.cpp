@@ -0,0 +1,212 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace
+{
+    // the pool and deque of the worker running on this thread
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local size_t currentQueue = 0;
+}
+
+ThreadPool::ThreadPool(size_t numThreads)
+{
+    if (numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < numThreads; ++i)
+        queues.push_back(std::make_unique<TaskQueue>());
+
+    for (size_t i = 1; i < numThreads; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i - 1);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task)
+{
+    if (workers.empty() || count <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> job{ jobMutex };
+    std::unique_lock<std::mutex> lock{ mutex };
+    this->task = &task;
+    taskCount = count;
+    nextTask = 0;
+    remainingTasks = count;
+    error = nullptr;
+    wake.notify_all();
+
+    runTasks(lock);
+    finished.wait(lock, [this] { return remainingTasks == 0; });
+    this->task = nullptr;
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    const size_t home = currentPool == this ? currentQueue : queues.size() - 1;
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        ++unfinishedTasks;
+    }
+    {
+        std::lock_guard<std::mutex> lock{ queues[home]->mutex };
+        queues[home]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        ++queuedTasks;
+    }
+    wake.notify_one();
+    // a thread in wait() helps with it too, it may be sleeping on a task submitted by a task
+    tasksFinished.notify_all();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock{ mutex };
+    while (unfinishedTasks > 0)
+    {
+        if (queuedTasks > 0)
+        {
+            --queuedTasks;
+            lock.unlock();
+            runQueuedTask(queues.size() - 1);
+            lock.lock();
+        }
+        else
+        {
+            tasksFinished.wait(lock, [this] { return unfinishedTasks == 0 || queuedTasks > 0; });
+        }
+    }
+
+    std::exception_ptr thrown = taskError;
+    taskError = nullptr;
+    lock.unlock();
+
+    if (thrown)
+        std::rethrow_exception(thrown);
+}
+
+void ThreadPool::workerLoop(size_t index)
+{
+    currentPool = this;
+    currentQueue = index;
+
+    std::unique_lock<std::mutex> lock{ mutex };
+    while (true)
+    {
+        wake.wait(lock, [this] { return stopping || queuedTasks > 0 || (task && nextTask < taskCount); });
+        if (stopping)
+            return;
+
+        // a parallelFor blocks its caller, so it goes before submitted tasks
+        if (task && nextTask < taskCount)
+        {
+            runTasks(lock);
+            continue;
+        }
+
+        --queuedTasks;
+        lock.unlock();
+        runQueuedTask(index);
+        lock.lock();
+    }
+}
+
+void ThreadPool::runTasks(std::unique_lock<std::mutex>& lock)
+{
+    while (task && nextTask < taskCount)
+    {
+        const size_t index = nextTask++;
+        const auto* current = task;
+        lock.unlock();
+        try
+        {
+            (*current)(index);
+        }
+        catch (...)
+        {
+            lock.lock();
+            if (!error)
+                error = std::current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+
+        if (--remainingTasks == 0)
+            finished.notify_all();
+    }
+}
+
+void ThreadPool::runQueuedTask(size_t home)
+{
+    // the caller claimed one of queuedTasks, so a task is in some deque: the newest
+    // of a worker's own, the oldest of the shared one, or else the oldest of another one
+    const bool shared = home == queues.size() - 1;
+    std::function<void()> work;
+    while (!work)
+    {
+        {
+            TaskQueue& own = *queues[home];
+            std::lock_guard<std::mutex> lock{ own.mutex };
+            if (!own.tasks.empty())
+            {
+                if (shared)
+                {
+                    work = std::move(own.tasks.front());
+                    own.tasks.pop_front();
+                }
+                else
+                {
+                    work = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                }
+                break;
+            }
+        }
+
+        for (size_t offset = 1; offset < queues.size() && !work; ++offset)
+        {
+            TaskQueue& victim = *queues[(home + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock{ victim.mutex };
+            if (!victim.tasks.empty())
+            {
+                work = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+            }
+        }
+    }
+
+    try
+    {
+        work();
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock{ mutex };
+        if (!taskError)
+            taskError = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock{ mutex };
+    if (--unfinishedTasks == 0)
+        tasksFinished.notify_all();
+}
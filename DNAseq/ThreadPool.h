@@ -0,0 +1,73 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that stay alive between jobs, so the solvers can fan
+// out every iteration without paying for thread creation. Besides the blocking
+// parallelFor, independent tasks can be submitted; every worker has its own deque
+// of them and idle workers steal from the others.
+class ThreadPool
+{
+public:
+    // numThreads counts the calling thread, which takes part in every job;
+    // 0 means one per hardware thread
+    explicit ThreadPool(size_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size() + 1; }
+
+    // Runs task(0) .. task(count - 1) and returns when all of them finished. The
+    // first exception thrown by a task is rethrown here.
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+    // Queues a task. Tasks submitted by a task running on a worker go to that
+    // worker's deque and run newest first, idle workers steal the oldest task of
+    // another deque. Other threads submit to a shared deque taken in FIFO order.
+    void submit(std::function<void()> task);
+
+    // Runs queued tasks on the calling thread until every submitted task finished,
+    // then rethrows the first exception one of them threw. Not to be called from a
+    // task.
+    void wait();
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerLoop(size_t index);
+    void runTasks(std::unique_lock<std::mutex>& lock);
+    void runQueuedTask(size_t home);
+
+    std::vector<std::thread> workers;
+    std::mutex jobMutex; // one parallelFor at a time
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+
+    const std::function<void(size_t)>* task = nullptr;
+    size_t taskCount = 0;
+    size_t nextTask = 0;
+    size_t remainingTasks = 0;
+    std::exception_ptr error;
+    bool stopping = false;
+
+    // submitted tasks: one deque per worker and the shared one last
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    size_t queuedTasks = 0; // not yet claimed by a thread
+    size_t unfinishedTasks = 0;
+    std::condition_variable tasksFinished;
+    std::exception_ptr taskError;
+};
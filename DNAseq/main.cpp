@@ -1,11 +1,20 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <string>
 #include <thread>
-#include <mutex>
 
-#include "AntColony.h"
+#include "Batch.h"
+#include "Distributed.h"
 #include "Instance.h"
-#include "LocalSearch.h"
 #include "Logger.h"
+#include "Sequencer.h"
+#include "Service.h"
+#include "SpectrumGenerator.h"
 #include "Timer.h"
 
 #define STRINGIFY(x) #x
@@ -18,95 +27,323 @@
     std::string projectPath{ "path/to/project" };
 #endif
 
-#define FIXED_FLOAT(x) std::fixed << std::setprecision(3) << (x)
+void printUsage()
+{
+    std::cout << "usage: DNAseq [--jobs N] [--budget MS] [--cache] [--cache-dir DIR] [--log-level LEVEL]\n"
+              << "              [--metrics FILE] [solver options] [--listen ADDRESS [--spawn N]] [directory]\n"
+              << "  --jobs N         instances solved at once, 0 = one per hardware thread (default)\n"
+              << "  --budget MS      wall-clock budget per instance in milliseconds, 0 = none (default)\n"
+              << "  --cache          reuse overlap graphs cached next to the spectra\n"
+              << "  --cache-dir DIR  reuse overlap graphs cached in DIR\n"
+              << "  --log-level LEVEL  trace, debug, info (default), warning, error, critical or off\n"
+              << "  --metrics FILE   appends solver metrics as one JSON line per instance, - = stdout\n"
+              << "  --listen ADDRESS hands the instances to workers connecting to ADDRESS, which is\n"
+              << "                   unix:PATH or HOST:PORT, instead of solving them here\n"
+              << "  --spawn N        starts N local workers for --listen\n"
+              << "  directory        spectra to solve, the tests directory by default\n"
+              << "solver options:\n"
+              << "  --islands N      runs N ant colonies per instance that exchange their best paths\n"
+              << "  --pipeline       runs local search next to a single colony, on every longer path it finds;\n"
+              << "                   not with --islands\n"
+              << "  --search-threads N  threads of the pipelined local search, 1 by default\n"
+              << "  --feedback       paths the pipelined local search made longer reinforce the colony\n"
+              << "  --compact        merges chains of unambiguous overlaps into single vertices first\n"
+              << "  --beam           a beam search alone instead of the ant colony, in milliseconds\n"
+              << "  --beam-width N   paths the beam search keeps at every step, 64 by default\n"
+              << "  --beam-seed      the beam search path reinforces the colony before it starts\n"
+              << "  --stagnation N   colony iterations without a longer path before it stops,\n"
+              << "                   50 by default, 0 = never\n"
+              << "  --search-stagnation N  local search steps without improvement before it stops,\n"
+              << "                   30 by default, 0 = never\n"
+              << "       DNAseq worker [--threads N] [solver options] [--cache-dir DIR] ADDRESS\n"
+              << "  solves the instances a coordinator listening on ADDRESS sends, on N threads;\n"
+              << "  --cache-dir reuses the overlap graphs of spectra seen before, here and for\n"
+              << "  serve's SOLVE requests\n"
+              << "       DNAseq serve [--jobs N] [--queue Q] [--budget MS] [solver options] [--cache]\n"
+              << "                    [--cache-dir DIR] [--file-root DIR] [--listen ADDRESS]\n"
+              << "  solves the spectra sent on stdin, or by clients connecting to ADDRESS, until\n"
+              << "  SHUTDOWN; N at once with Q more waiting (16 by default), see Service.h;\n"
+              << "  FILE requests may only read spectra under the --file-root directory\n"
+              << "       DNAseq generate [--n N] [--l L] [--sequence FILE] [--type TYPE] [--rate R]\n"
+              << "                       [--seed S] [--count C] directory\n"
+              << "  writes C spectra and their .ref reference sequences to directory; TYPE is none,\n"
+              << "  negative-random, negative-repeat, positive-random or positive-wrong-ending and\n"
+              << "  R the errors as a fraction of the spectrum size\n";
+}
 
-class Sequencer
+// Consumes argv[i] and its value if it is one of the solver options in printUsage.
+bool parseSequencerOption(int argc, char** argv, int& i, SequencerOptions& options)
 {
-public:
-    virtual ~Sequencer() {};
-    virtual size_t run(const Instance& instance) = 0; // returns number of oligonucleotides used
-    virtual std::string getName() const = 0;
-};
+    if (std::strcmp(argv[i], "--islands") == 0 && i + 1 < argc)
+        options.islands = std::stoul(argv[++i]);
+    else if (std::strcmp(argv[i], "--pipeline") == 0)
+        options.pipelined = true;
+    else if (std::strcmp(argv[i], "--search-threads") == 0 && i + 1 < argc)
+        options.searchThreads = std::stoul(argv[++i]);
+    else if (std::strcmp(argv[i], "--feedback") == 0)
+        options.feedback = true;
+    else if (std::strcmp(argv[i], "--compact") == 0)
+        options.compact = true;
+    else if (std::strcmp(argv[i], "--beam") == 0)
+        options.solver = SequencerOptions::BEAM;
+    else if (std::strcmp(argv[i], "--beam-width") == 0 && i + 1 < argc)
+        options.beamWidth = std::stoul(argv[++i]);
+    else if (std::strcmp(argv[i], "--beam-seed") == 0)
+        options.beamSeed = true;
+    else if (std::strcmp(argv[i], "--stagnation") == 0 && i + 1 < argc)
+        options.colonyStagnation = std::stoul(argv[++i]);
+    else if (std::strcmp(argv[i], "--search-stagnation") == 0 && i + 1 < argc)
+        options.searchStagnation = std::stoul(argv[++i]);
+    else
+        return false;
+    return true;
+}
 
-class Our_Sequencer : public Sequencer
+// Rejects solver options that do not go together, after the last one was parsed.
+void checkSequencerOptions(const SequencerOptions& options)
 {
-public:
-    virtual size_t run(const Instance& instance) override
+    if (options.pipelined && options.islands > 1)
     {
-        // use AntColony and LocalSearch
-        AntColony antColony(instance, AntColony::Parameters(300, 200, 1.0f, 1.0f, 0.7f));
-        std::vector<int> result = antColony.Run();
+        LOG_ERROR("--pipeline runs a single colony, it cannot be combined with --islands");
+        throw std::invalid_argument{ "--pipeline with --islands" };
+    }
+}
 
-        Solution lsInput = Solution{ result.begin(), result.end() };
-        LocalSearch localSearch(instance, lsInput);
-        Solution improvedResult = localSearch.run();
+// the solver options that give `options` to a worker
+std::vector<std::string> sequencerArguments(const SequencerOptions& options)
+{
+    std::vector<std::string> arguments{ "--islands", std::to_string(options.islands),
+        "--search-threads", std::to_string(options.searchThreads), "--beam-width", std::to_string(options.beamWidth),
+        "--stagnation", std::to_string(options.colonyStagnation),
+        "--search-stagnation", std::to_string(options.searchStagnation) };
+    if (options.pipelined)
+        arguments.push_back("--pipeline");
+    if (options.feedback)
+        arguments.push_back("--feedback");
+    if (options.compact)
+        arguments.push_back("--compact");
+    if (options.solver == SequencerOptions::BEAM)
+        arguments.push_back("--beam");
+    if (options.beamSeed)
+        arguments.push_back("--beam-seed");
+    return arguments;
+}
 
-        LOG_INFO("sequence: {}", instance.output(improvedResult));
-        LOG_INFO("length: {}/{}", instance.outputLength(improvedResult), instance.n);
+// `DNAseq generate ...`, see printUsage
+int generate(int argc, char** argv)
+{
+    static const std::pair<const char*, Instance::ErrorType> types[] = {
+        { "none", Instance::NONE },
+        { "negative-random", Instance::NEGATIVE_RANDOM },
+        { "negative-repeat", Instance::NEGATIVE_REPEAT },
+        { "positive-random", Instance::POSITIVE_RANDOM },
+        { "positive-wrong-ending", Instance::POSITIVE_WRONG_ENDING }
+    };
 
-        return improvedResult.size();
+    SpectrumOptions options;
+    size_t count = 1;
+    std::filesystem::path directory;
+    try
+    {
+        for (int i = 2; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--n") == 0 && i + 1 < argc)
+                options.n = std::stoul(argv[++i]);
+            else if (std::strcmp(argv[i], "--l") == 0 && i + 1 < argc)
+                options.l = std::stoul(argv[++i]);
+            else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+                options.errorRate = std::stod(argv[++i]);
+            else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+                options.seed = std::stoull(argv[++i]);
+            else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc)
+                count = std::stoul(argv[++i]);
+            else if (std::strcmp(argv[i], "--type") == 0 && i + 1 < argc)
+            {
+                const char* name = argv[++i];
+                auto type = std::find_if(std::begin(types), std::end(types),
+                    [&](const auto& entry) { return std::strcmp(entry.first, name) == 0; });
+                if (type == std::end(types))
+                    throw std::invalid_argument{ name };
+                options.errorType = type->second;
+            }
+            else if (std::strcmp(argv[i], "--sequence") == 0 && i + 1 < argc)
+            {
+                std::ifstream file{ argv[++i] };
+                if (!file)
+                    throw std::invalid_argument{ argv[i] };
+                for (char c; file.get(c);)
+                {
+                    if (!std::isspace(static_cast<unsigned char>(c)))
+                        options.sequence += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+                }
+            }
+            else if (argv[i][0] != '-' && directory.empty())
+                directory = argv[i];
+            else
+                throw std::invalid_argument{ argv[i] };
+        }
+
+        if (directory.empty())
+            throw std::invalid_argument{ "no directory" };
+    }
+    catch (const std::exception&)
+    {
+        printUsage();
+        return 1;
     }
 
-    virtual std::string getName() const override
+    try
     {
-        return "Our Sequencer";
+        for (size_t id = 1; id <= count; ++id)
+        {
+            GeneratedSpectrum spectrum = generateSpectrum(options, id);
+            writeSpectrum(spectrum, directory);
+            LOG_INFO("Generated {}", (directory / spectrum.name).string());
+        }
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("{}", e.what());
+        return 1;
     }
 
-private:
-};
+    return 0;
+}
 
-class Tester
+// `DNAseq worker ...`, see printUsage
+int worker(int argc, char** argv)
 {
-    using Insts = std::vector<Instance>;
+    size_t threads = 0;
+    SequencerOptions sequencerOptions;
+    InstanceOptions options;
+    std::string address;
+    try
+    {
+        for (int i = 2; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+                threads = std::stoul(argv[++i]);
+            else if (parseSequencerOption(argc, argv, i, sequencerOptions))
+                continue;
+            else if (std::strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc)
+            {
+                options.useCache = true;
+                options.cacheDirectory = argv[++i];
+                std::filesystem::create_directories(options.cacheDirectory);
+            }
+            else if (argv[i][0] != '-' && address.empty())
+                address = argv[i];
+            else
+                throw std::invalid_argument{ argv[i] };
+        }
+
+        if (address.empty())
+            throw std::invalid_argument{ "no address" };
+        checkSequencerOptions(sequencerOptions);
+    }
+    catch (const std::exception&)
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::atomic<uint64_t> nextSeed{ (uint64_t)rand() };
+    SequencerFactory makeSequencer = [&] {
+        return createSequencer(threads, nextSeed++, sequencerOptions);
+    };
 
-public:
+    try
+    {
+        runWorker(address, makeSequencer, options);
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("{}", e.what());
+        return 1;
+    }
 
-    static void test(Sequencer& s, Insts& tests)
+    return 0;
+}
+
+// `DNAseq serve ...`, see printUsage
+int serve(int argc, char** argv)
+{
+    ServiceOptions options;
+    SequencerOptions sequencerOptions;
+    std::string address;
+    try
     {
-        Timer timer;
-        std::cout << "##### RUNNING TEST ON: " << s.getName() << " #####\n";
-        for (const Instance& instance : tests)
+        for (int i = 2; i < argc; ++i)
         {
-            timer.start();
-            size_t used = s.run(instance);
-            double elapsedMS = timer.elapsedMilliseconds();
-
-            float acc = used / (float)instance.bestSolutionSize;
-            LOG_INFO("{} acc: {}/{} = {}", instance.name, used, instance.bestSolutionSize, acc);
-            LOG_INFO("time: {}", elapsedMS);
-            //std::cout << instance.name << ',' << FIXED_FLOAT(acc) << ',' << FIXED_FLOAT(elapsedMS) << '\n'; // csv output
+            if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+                options.solvers = std::stoul(argv[++i]);
+            else if (std::strcmp(argv[i], "--queue") == 0 && i + 1 < argc)
+                options.queueCapacity = std::stoul(argv[++i]);
+            else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+                options.budget = std::chrono::milliseconds{ std::stol(argv[++i]) };
+            else if (parseSequencerOption(argc, argv, i, sequencerOptions))
+                continue;
+            else if (std::strcmp(argv[i], "--cache") == 0)
+                options.instanceOptions.useCache = true;
+            else if (std::strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc)
+            {
+                options.instanceOptions.useCache = true;
+                options.instanceOptions.cacheDirectory = argv[++i];
+                std::filesystem::create_directories(options.instanceOptions.cacheDirectory);
+            }
+            else if (std::strcmp(argv[i], "--file-root") == 0 && i + 1 < argc)
+                options.fileRoot = argv[++i];
+            else if (std::strcmp(argv[i], "--listen") == 0 && i + 1 < argc)
+                address = argv[++i];
+            else
+                throw std::invalid_argument{ argv[i] };
         }
+        checkSequencerOptions(sequencerOptions);
+    }
+    catch (const std::exception&)
+    {
+        printUsage();
+        return 1;
     }
 
-    static void compare(Sequencer& s1, Sequencer& s2, const Insts& tests)
+    // requests share the hardware threads as the instances of a batch do
+    if (options.solvers == 0)
+        options.solvers = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    const size_t sequencerThreads = options.solvers > 1 ? 1 : 0;
+    std::atomic<uint64_t> nextSeed{ (uint64_t)rand() };
+    SequencerFactory makeSequencer = [&] {
+        return createSequencer(sequencerThreads, nextSeed++, sequencerOptions);
+    };
+
+    try
     {
-        std::cout << "##### RUNNING COMPARISON BETWEEN: " << s1.getName()
-                  << " AND " << s2.getName() << " #####\n";
-        for (const Instance& instance : tests)
+        Service service{ makeSequencer, options };
+        if (address.empty())
         {
-            size_t u1 = s1.run(instance);
-            size_t u2 = s2.run(instance);
-            float acc1 = u1 / (float)instance.s;
-            float acc2 = u2 / (float)instance.s;
-            float diff = acc2 - acc1;
-            std::cout << instance.name << ":\t" << FIXED_FLOAT(acc1) << '\t'
-                      << FIXED_FLOAT(acc2) << '\t' << FIXED_FLOAT(diff) << '\n';
+            service.serve(std::cin, std::cout);
         }
+        else
+        {
+            Socket listener = Socket::listen(address);
+            LOG_INFO("serving on {} with {} solvers", address, options.solvers);
+            service.serve(listener);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("{}", e.what());
+        return 1;
     }
-};
 
-void loadInstance(std::filesystem::path path, std::vector<Instance>* tests, std::mutex* mutex)
-{
-    Instance&& instance = Instance{ path };
-    mutex->lock();
-    LOG_INFO("Loaded {}", path.string());
-    tests->push_back(instance);
-    mutex->unlock();
+    return 0;
 }
 
-int main() {
+int main(int argc, char** argv) {
     srand(time(nullptr));
     Logger::Init();
+    // replies to `serve` may go to stdout
+    if (argc > 1 && std::strcmp(argv[1], "serve") == 0)
+        Logger::UseStderr();
 
     LOG_INFO("Logger initialized.");
 
@@ -123,25 +360,162 @@ int main() {
     projectPath.erase(projectPath.size() - 2); // erase the last quote and the dot
 #endif // PROJECT_PATH
 
-    std::vector<Instance> tests;
+    if (argc > 1 && std::strcmp(argv[1], "generate") == 0)
+        return generate(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "worker") == 0)
+        return worker(argc, argv);
+    if (argc > 1 && std::strcmp(argv[1], "serve") == 0)
+        return serve(argc, argv);
+
+    size_t jobs = 0;
+    std::chrono::milliseconds budget{ 0 };
+    InstanceOptions options;
+    std::string metricsPath;
+    SequencerOptions sequencerOptions;
+    std::string listenAddress;
+    size_t spawn = 0;
     std::filesystem::path path{ projectPath + "/tests" };
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+                jobs = std::stoul(argv[++i]);
+            else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+                budget = std::chrono::milliseconds{ std::stol(argv[++i]) };
+            else if (std::strcmp(argv[i], "--cache") == 0)
+                options.useCache = true;
+            else if (std::strcmp(argv[i], "--cache-dir") == 0 && i + 1 < argc)
+            {
+                options.useCache = true;
+                options.cacheDirectory = argv[++i];
+                std::filesystem::create_directories(options.cacheDirectory);
+            }
+            else if (std::strcmp(argv[i], "--log-level") == 0 && i + 1 < argc)
+            {
+                const char* name = argv[++i];
+                spdlog::level::level_enum level = spdlog::level::from_str(name);
+                if (level == spdlog::level::off && std::strcmp(name, "off") != 0)
+                    throw std::invalid_argument{ name };
+                Logger::Init(level);
+            }
+            else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+                metricsPath = argv[++i];
+            else if (parseSequencerOption(argc, argv, i, sequencerOptions))
+                continue;
+            else if (std::strcmp(argv[i], "--listen") == 0 && i + 1 < argc)
+                listenAddress = argv[++i];
+            else if (std::strcmp(argv[i], "--spawn") == 0 && i + 1 < argc)
+                spawn = std::stoul(argv[++i]);
+            else if (argv[i][0] != '-')
+                path = argv[i];
+            else
+                throw std::invalid_argument{ argv[i] };
+        }
+        checkSequencerOptions(sequencerOptions);
+    }
+    catch (const std::exception&)
+    {
+        printUsage();
+        return 1;
+    }
 
-    std::vector<std::thread> workers;
-    std::mutex mutex;
+    std::vector<std::filesystem::path> files;
     for (const auto& entry : std::filesystem::directory_iterator(path))
     {
-        workers.push_back(std::thread(loadInstance, entry.path(), &tests, &mutex));
-        // break; // DEBUG: hard coded to test only one instance
+        const auto extension = entry.path().extension();
+        if (entry.is_regular_file() && extension != CACHE_EXTENSION && extension != REFERENCE_EXTENSION)
+            files.push_back(entry.path());
     }
 
-    for (auto& worker : workers)
+    ResultCollector results;
+    Timer timer;
+    timer.start();
+    if (!listenAddress.empty())
     {
-        worker.join();
+        try
+        {
+            Socket listener = Socket::listen(listenAddress);
+
+            // local workers share the hardware threads
+            std::vector<intptr_t> spawned;
+            const size_t workerThreads = std::max<size_t>(std::thread::hardware_concurrency() / std::max<size_t>(spawn, 1), 1);
+            for (size_t i = 0; i < spawn; ++i)
+            {
+                std::vector<std::string> arguments{ "worker", "--threads", std::to_string(workerThreads) };
+                for (std::string& argument : sequencerArguments(sequencerOptions))
+                    arguments.push_back(std::move(argument));
+                arguments.push_back(listenAddress);
+                spawned.push_back(spawnProcess(argv[0], arguments));
+            }
+
+            std::cout << "##### RUNNING " << files.size() << " INSTANCES ON WORKERS AT " << listenAddress << " #####\n";
+            // once the spawned workers exited and no other is connected, the files left fail
+            std::function<bool()> workersMayConnect;
+            if (spawn > 0)
+            {
+                workersMayConnect = [&spawned] {
+                    spawned.erase(std::remove_if(spawned.begin(), spawned.end(), processExited), spawned.end());
+                    return !spawned.empty();
+                };
+            }
+            runCoordinator(std::move(files), listener, results, budget, 3, workersMayConnect);
+
+            for (intptr_t process : spawned)
+                waitForProcess(process);
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR("{}", e.what());
+            return 1;
+        }
+    }
+    else
+    {
+        // instances are spread over the pool, so each one is solved on a single thread
+        // unless the pool has only one; islands still get a thread each
+        ThreadPool pool{ jobs };
+        std::atomic<uint64_t> nextSeed{ (uint64_t)rand() };
+        size_t sequencerThreads = pool.size() > 1 ? 1 : 0;
+        SequencerFactory makeSequencer = [&] {
+            return createSequencer(sequencerThreads, nextSeed++, sequencerOptions);
+        };
+
+        std::cout << "##### RUNNING " << files.size() << " INSTANCES ON " << pool.size() << " THREADS #####\n";
+        runBatch(std::move(files), makeSequencer, pool, results, budget, options);
+    }
+
+    for (const BatchResult& result : results.results())
+    {
+        if (!result.error.empty())
+        {
+            LOG_ERROR("{} failed: {}", result.name, result.error);
+            continue;
+        }
+
+        float acc = result.used / (float)result.bestSolutionSize;
+        LOG_INFO("{} acc: {}/{} = {}", result.name, result.used, result.bestSolutionSize, acc);
+        LOG_INFO("time: {}", result.milliseconds);
     }
+    LOG_INFO("batch time: {}", timer.elapsedMilliseconds());
 
-    Our_Sequencer ourSequencer{};
-    Tester::test(ourSequencer, tests);
+    if (!metricsPath.empty())
+    {
+        std::ofstream file;
+        if (metricsPath != "-")
+        {
+            file.open(metricsPath, std::ios::app);
+            if (!file)
+            {
+                LOG_ERROR("cannot write metrics to {}", metricsPath);
+                return 1;
+            }
+        }
+
+        std::ostream& out = metricsPath == "-" ? std::cout : file;
+        for (const BatchResult& result : results.results())
+            out << result.metrics << '\n';
+    }
 
     return 0;
 }
-